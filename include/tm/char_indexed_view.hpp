@@ -0,0 +1,151 @@
+#pragma once
+
+#include <assert.h>
+#include <stddef.h>
+
+#include "tm/simd.hpp"
+#include "tm/string.hpp"
+#include "tm/string_view.hpp"
+#include "tm/vector.hpp"
+
+namespace TM {
+
+/**
+ * A read-only view of UTF-8 bytes that can look up characters
+ * (code points) by index. Building it notes whether the bytes
+ * are all ASCII, and otherwise records the byte offset of every
+ * STRIDE-th character, so each lookup takes constant time for
+ * ASCII and walks at most STRIDE - 1 characters otherwise.
+ * String::char_at() counts from the start on every call instead.
+ *
+ * Like StringView, this points into the bytes it was built from.
+ * Modifying or destroying the source String invalidates it. That
+ * includes calling the non-const String::operator[], which can
+ * move a shared buffer. Since the index never changes after
+ * construction, a view can be read from several threads at once.
+ *
+ * ```
+ * auto str = String { "aé☺🐄z" };
+ * auto view = CharIndexedView { str };
+ * assert_eq(5, view.char_count());
+ * assert_str_eq("a", view.char_at(0));
+ * assert_str_eq("é", view.char_at(1));
+ * assert_str_eq("☺", view.char_at(2));
+ * assert_str_eq("🐄", view.char_at(3));
+ * assert_str_eq("z", view.char_at(4));
+ * ```
+ */
+class CharIndexedView {
+public:
+    // Number of characters between recorded offsets.
+    static constexpr size_t STRIDE = 64;
+
+    explicit CharIndexedView(const String &str)
+        : CharIndexedView { StringView { str } } { }
+
+    explicit CharIndexedView(StringView view)
+        : m_data { view.data() }
+        , m_size { view.size() }
+        , m_ascii { SIMD::is_ascii(m_data, m_size) } {
+        if (m_ascii) {
+            m_char_count = m_size;
+            return;
+        }
+        size_t count = 0;
+        for (size_t i = 0; i < m_size; i++) {
+            if (((unsigned char)m_data[i] & 0xC0) == 0x80)
+                continue;
+            if (count % STRIDE == 0)
+                m_offsets.push(i);
+            count++;
+        }
+        // so that the character count itself maps to the size
+        if (count % STRIDE == 0)
+            m_offsets.push(m_size);
+        m_char_count = count;
+    }
+
+    size_t char_count() const { return m_char_count; }
+
+    bool is_ascii() const { return m_ascii; }
+
+    /**
+     * Returns the byte offset where the character at the given
+     * index starts. Passing char_count() returns the size.
+     *
+     * ```
+     * auto str = String();
+     * for (size_t i = 0; i < 1000; i++)
+     *     str.append(i % 3 == 0 ? "é" : "x");
+     * auto view = CharIndexedView { str };
+     * assert_not(view.is_ascii());
+     * size_t expected = 0;
+     * for (size_t i = 0; i < 1000; i++) {
+     *     assert_eq(expected, view.byte_offset_of_char(i));
+     *     expected += i % 3 == 0 ? 2 : 1;
+     * }
+     * assert_eq(str.size(), view.byte_offset_of_char(1000));
+     *
+     * auto ascii = CharIndexedView { StringView("abc") };
+     * assert(ascii.is_ascii());
+     * assert_eq(2, ascii.byte_offset_of_char(2));
+     * assert_eq(0, CharIndexedView { String() }.byte_offset_of_char(0));
+     * ```
+     *
+     * This method aborts if the index is past the end.
+     *
+     * ```should_abort
+     * auto str = String { "é" };
+     * auto view = CharIndexedView { str };
+     * view.byte_offset_of_char(2);
+     * ```
+     */
+    size_t byte_offset_of_char(const size_t index) const {
+        assert(index <= m_char_count);
+        if (m_ascii)
+            return index;
+        size_t offset = m_offsets[index / STRIDE];
+        for (size_t remaining = index % STRIDE; remaining > 0; remaining--) {
+            offset++;
+            while (offset < m_size && ((unsigned char)m_data[offset] & 0xC0) == 0x80)
+                offset++;
+        }
+        return offset;
+    }
+
+    /**
+     * Returns a view of the character at the given index.
+     *
+     * ```
+     * auto str = String { "🐄🐄🐄!" };
+     * auto view = CharIndexedView { str };
+     * assert_eq(str.c_str() + 8, view.char_at(2).data());
+     * assert_str_eq("!", view.char_at(3));
+     * ```
+     *
+     * This method aborts if the index is past the last character.
+     *
+     * ```should_abort
+     * auto str = String { "é" };
+     * auto view = CharIndexedView { str };
+     * view.char_at(1);
+     * ```
+     */
+    StringView char_at(const size_t index) const {
+        const size_t start = byte_offset_of_char(index);
+        assert(start < m_size);
+        size_t end = start + 1;
+        while (end < m_size && ((unsigned char)m_data[end] & 0xC0) == 0x80)
+            end++;
+        return StringView { m_data + start, end - start };
+    }
+
+private:
+    const char *m_data;
+    size_t m_size;
+    bool m_ascii;
+    size_t m_char_count { 0 };
+    Vector<size_t> m_offsets {};
+};
+
+}
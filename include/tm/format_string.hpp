@@ -0,0 +1,64 @@
+#pragma once
+
+#include <assert.h>
+#include <stddef.h>
+
+namespace TM {
+
+/**
+ * A format string for String::format whose "{}" placeholders
+ * are located when it is constructed. Declared constexpr, the
+ * scan happens at compile time and formatting only copies the
+ * literal segments between the recorded offsets.
+ *
+ * ```
+ * constexpr FormatString fmt { "{} + {} = {}" };
+ * static_assert(fmt.length() == 12);
+ * static_assert(fmt.placeholder_count() == 3);
+ * static_assert(fmt.placeholder(1) == 5);
+ * assert_str_eq("1 + 2 = 3", String::format(fmt, 1, 2, 3));
+ * ```
+ */
+template <size_t N>
+class FormatString {
+public:
+    constexpr FormatString(const char (&str)[N])
+        : m_str { str } {
+        for (size_t i = 0; i + 1 < length(); i++) {
+            if (str[i] == '{' && str[i + 1] == '}') {
+                m_placeholders[m_placeholder_count++] = i;
+                i++;
+            }
+        }
+    }
+
+    constexpr const char *c_str() const { return m_str; }
+
+    /**
+     * Returns the number of bytes in the format string,
+     * not counting the null terminator.
+     */
+    constexpr size_t length() const { return N - 1; }
+
+    constexpr size_t placeholder_count() const { return m_placeholder_count; }
+
+    /**
+     * Returns the byte offset of the placeholder at the given index.
+     *
+     * ```should_abort
+     * FormatString fmt { "{}" };
+     * fmt.placeholder(1);
+     * ```
+     */
+    constexpr size_t placeholder(size_t index) const {
+        assert(index < m_placeholder_count);
+        return m_placeholders[index];
+    }
+
+private:
+    const char *m_str;
+    size_t m_placeholders[N / 2 + 1] {};
+    size_t m_placeholder_count { 0 };
+};
+
+}
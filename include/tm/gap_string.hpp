@@ -0,0 +1,333 @@
+#pragma once
+
+#include <algorithm>
+#include <assert.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "tm/string.hpp"
+#include "tm/string_view.hpp"
+
+namespace TM {
+
+/**
+ * A string that keeps a gap of unused bytes at its most recent
+ * edit point. Inserting or removing bytes next to the previous
+ * edit only touches the gap, so repeated prepends, or a run of
+ * inserts at nearby positions, cost O(1) amortized instead of
+ * moving the whole tail like String::prepend() and
+ * String::insert() do. The bytes are made contiguous when
+ * c_str() or to_string() is called.
+ *
+ * ```
+ * auto str = GapString("body");
+ * for (int i = 0; i < 3; i++)
+ *     str.prepend("  ");
+ * str.insert(6, "<");
+ * str.append(">");
+ * assert_eq(12, str.size());
+ * assert_str_eq("      <body>", String(str.c_str()));
+ * ```
+ */
+class GapString {
+public:
+    static constexpr size_t MIN_GAP_SIZE = 16;
+
+    /**
+     * Constructs an empty GapString. No memory is allocated
+     * until the first insert.
+     *
+     * ```
+     * auto str = GapString();
+     * assert(str.is_empty());
+     * assert_str_eq("", String(str.c_str()));
+     * ```
+     */
+    GapString() { }
+
+    GapString(const char *str, size_t length) {
+        insert(0, str, length);
+    }
+
+    GapString(const char *str)
+        : GapString { str, strlen(str) } { }
+
+    GapString(const String &str)
+        : GapString { str.c_str(), str.size() } { }
+
+    /**
+     * Copies another GapString, including its gap position.
+     *
+     * ```
+     * auto str1 = GapString("foo");
+     * str1.prepend("x");
+     * auto str2 = GapString(str1);
+     * str2.prepend("y");
+     * assert_str_eq("xfoo", String(str1.c_str()));
+     * assert_str_eq("yxfoo", String(str2.c_str()));
+     * ```
+     */
+    GapString(const GapString &other)
+        : m_capacity { other.m_capacity }
+        , m_gap_start { other.m_gap_start }
+        , m_gap_end { other.m_gap_end } {
+        if (other.m_data) {
+            m_data = new char[m_capacity];
+            memcpy(m_data, other.m_data, m_gap_start);
+            memcpy(m_data + m_gap_end, other.m_data + m_gap_end, m_capacity - m_gap_end);
+        }
+    }
+
+    GapString(GapString &&other)
+        : m_data { other.m_data }
+        , m_capacity { other.m_capacity }
+        , m_gap_start { other.m_gap_start }
+        , m_gap_end { other.m_gap_end } {
+        other.m_data = nullptr;
+        other.m_capacity = other.m_gap_start = other.m_gap_end = 0;
+    }
+
+    GapString &operator=(const GapString &other) {
+        if (this != &other) {
+            GapString copy { other };
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+
+    GapString &operator=(GapString &&other) {
+        if (this != &other) {
+            delete[] m_data;
+            m_data = other.m_data;
+            m_capacity = other.m_capacity;
+            m_gap_start = other.m_gap_start;
+            m_gap_end = other.m_gap_end;
+            other.m_data = nullptr;
+            other.m_capacity = other.m_gap_start = other.m_gap_end = 0;
+        }
+        return *this;
+    }
+
+    ~GapString() {
+        delete[] m_data;
+    }
+
+    size_t size() const { return m_capacity - gap_size(); }
+    size_t length() const { return size(); }
+    bool is_empty() const { return size() == 0; }
+
+    /**
+     * Returns the byte at the given index.
+     *
+     * ```
+     * auto str = GapString("held");
+     * str.insert(2, "llo wor");
+     * assert_eq('h', str.at(0));
+     * assert_eq('l', str.at(2));
+     * assert_eq('d', str.at(10));
+     * ```
+     *
+     * This method aborts if the index is past the end.
+     *
+     * ```should_abort
+     * auto str = GapString("abc");
+     * str.at(3);
+     * ```
+     */
+    char at(size_t index) const {
+        assert(index < size());
+        return (*this)[index];
+    }
+
+    /**
+     * Returns the byte at the given index.
+     *
+     * WARNING: This method does *not* check that the given
+     * index is within the bounds of the string data!
+     */
+    char operator[](size_t index) const {
+        return index < m_gap_start ? m_data[index] : m_data[index + gap_size()];
+    }
+
+    /**
+     * Inserts the given bytes before the given index, moving the
+     * gap there first.
+     *
+     * ```
+     * auto str = GapString("ad");
+     * str.insert(1, "c", 1);
+     * str.insert(1, "b", 1);
+     * str.insert(4, "e", 1);
+     * assert_str_eq("abcde", String(str.c_str()));
+     * ```
+     *
+     * This method aborts if the index is past the end.
+     *
+     * ```should_abort
+     * auto str = GapString("abc");
+     * str.insert(4, "x", 1);
+     * ```
+     */
+    void insert(size_t index, const char *str, size_t length) {
+        assert(index <= size());
+        if (length == 0) return;
+        assert(str);
+        reserve_gap(length);
+        move_gap(index);
+        memcpy(m_data + m_gap_start, str, length);
+        m_gap_start += length;
+    }
+
+    void insert(size_t index, const char *str) {
+        assert(str);
+        insert(index, str, strlen(str));
+    }
+
+    void insert(size_t index, const String &str) {
+        insert(index, str.c_str(), str.size());
+    }
+
+    void insert(size_t index, StringView view) {
+        insert(index, view.data(), view.size());
+    }
+
+    void insert(size_t index, char c) {
+        insert(index, &c, 1);
+    }
+
+    void prepend(const char *str) { insert(0, str); }
+    void prepend(const String &str) { insert(0, str); }
+    void prepend(StringView view) { insert(0, view); }
+    void prepend_char(char c) { insert(0, c); }
+
+    void append(const char *str) { insert(size(), str); }
+    void append(const String &str) { insert(size(), str); }
+    void append(StringView view) { insert(size(), view); }
+    void append_char(char c) { insert(size(), c); }
+
+    /**
+     * Removes the given number of bytes starting at the given
+     * index. The gap simply widens to cover them.
+     *
+     * ```
+     * auto str = GapString("foo-bar-baz");
+     * str.remove(3, 4);
+     * assert_str_eq("foo-baz", String(str.c_str()));
+     * str.remove(0, 4);
+     * assert_str_eq("baz", String(str.c_str()));
+     * ```
+     *
+     * This method aborts if the range extends past the end.
+     *
+     * ```should_abort
+     * auto str = GapString("abc");
+     * str.remove(1, 3);
+     * ```
+     */
+    void remove(size_t index, size_t length) {
+        assert(index <= size());
+        assert(length <= size() - index);
+        if (length == 0) return;
+        move_gap(index);
+        m_gap_end += length;
+    }
+
+    /**
+     * Replaces the specified index+length bytes with the String given.
+     *
+     * ```
+     * auto str = GapString("foo-bar-baz");
+     * str.replace_bytes(4, 3, "buz");
+     * assert_str_eq("foo-buz-baz", String(str.c_str()));
+     * str.replace_bytes(4, 3, "b");
+     * assert_str_eq("foo-b-baz", String(str.c_str()));
+     * str.replace_bytes(4, 1, "bar");
+     * assert_str_eq("foo-bar-baz", String(str.c_str()));
+     * ```
+     */
+    void replace_bytes(size_t index, size_t length, const String &replacement) {
+        remove(index, length);
+        insert(index, replacement);
+    }
+
+    /**
+     * Moves the gap to the end and returns the contents as a
+     * null-terminated C string. The pointer is invalidated by
+     * the next modification.
+     *
+     * ```
+     * auto str = GapString("world");
+     * str.prepend("hello ");
+     * assert_eq(0, strcmp("hello world", str.c_str()));
+     * ```
+     */
+    const char *c_str() {
+        if (!m_data)
+            return "";
+        reserve_gap(1);
+        move_gap(size());
+        m_data[m_gap_start] = '\0';
+        return m_data;
+    }
+
+    /**
+     * Copies the contents into a new String, without moving
+     * the gap.
+     *
+     * ```
+     * auto str = GapString("bar");
+     * str.prepend("foo");
+     * assert_str_eq("foobar", str.to_string());
+     * assert_str_eq("", GapString().to_string());
+     * ```
+     */
+    String to_string() const {
+        if (!m_data)
+            return String();
+        String result { m_data, m_gap_start };
+        result.append(m_data + m_gap_end, m_capacity - m_gap_end);
+        return result;
+    }
+
+private:
+    size_t gap_size() const { return m_gap_end - m_gap_start; }
+
+    void move_gap(size_t index) {
+        if (index < m_gap_start) {
+            const size_t count = m_gap_start - index;
+            memmove(m_data + m_gap_end - count, m_data + index, count);
+            m_gap_start -= count;
+            m_gap_end -= count;
+        } else if (index > m_gap_start) {
+            const size_t count = index - m_gap_start;
+            memmove(m_data + m_gap_start, m_data + m_gap_end, count);
+            m_gap_start += count;
+            m_gap_end += count;
+        }
+    }
+
+    // Makes sure the gap can take the given number of bytes,
+    // doubling the buffer so that growth is amortized.
+    void reserve_gap(size_t needed) {
+        if (gap_size() >= needed) return;
+        const size_t length = size();
+        const size_t new_capacity = std::max(m_capacity * 2, length + needed + MIN_GAP_SIZE);
+        auto data = new char[new_capacity];
+        const size_t tail = m_capacity - m_gap_end;
+        if (m_data) {
+            memcpy(data, m_data, m_gap_start);
+            memcpy(data + new_capacity - tail, m_data + m_gap_end, tail);
+        }
+        delete[] m_data;
+        m_data = data;
+        m_gap_end = new_capacity - tail;
+        m_capacity = new_capacity;
+    }
+
+    char *m_data { nullptr };
+    size_t m_capacity { 0 };
+    size_t m_gap_start { 0 };
+    size_t m_gap_end { 0 };
+};
+
+}
@@ -10,6 +10,7 @@
 
 #include "tm/macros.hpp"
 #include "tm/string.hpp"
+#include "tm/string_view.hpp"
 
 namespace TM {
 
@@ -17,6 +18,7 @@ enum class HashType {
     Pointer,
     String,
     TMString,
+    StringView,
 };
 
 struct HashmapUtils {
@@ -147,6 +149,10 @@ public:
             m_hash_fn = &Hashmap::hash_tm_str;
             m_compare_fn = &Hashmap::compare_tm_str;
             break;
+        case HashType::StringView:
+            m_hash_fn = &Hashmap::hash_string_view;
+            m_compare_fn = &Hashmap::compare_string_view;
+            break;
         default:
             TM_UNREACHABLE();
         }
@@ -269,7 +275,7 @@ public:
         if constexpr (std::is_pointer_v<KeyT>) {
             return 0;
         } else {
-            auto str = (const String &)(ptr);
+            const auto &str = (const String &)(ptr);
             return str.djb2_hash();
         }
     }
@@ -294,6 +300,52 @@ public:
         }
     }
 
+    /**
+     * Returns a hash value for the given StringView based on the
+     * bytes it points at. Keys are stored as views, so the bytes
+     * must outlive the Hashmap.
+     *
+     * ```
+     * auto str = String("foo.foo.bar");
+     * auto map = Hashmap<StringView, Thing>(HashType::StringView);
+     * map.put(StringView(&str, 0, 3), Thing(1));
+     * map.put(StringView(&str, 4, 3), Thing(2));
+     * map.put(StringView(&str, 8, 3), Thing(3));
+     * assert_eq(2, map.size());
+     * assert_eq(Thing(2), map.get(StringView("foo")));
+     * assert_eq(Thing(3), map.get(StringView("bar")));
+     *
+     * auto key = StringView(&str, 4, 3);
+     * assert_eq(String("foo").djb2_hash(), Hashmap<StringView>::hash_string_view(key));
+     * ```
+     */
+    static size_t hash_string_view(KeyT &view) {
+        if constexpr (std::is_same_v<KeyT, TM::StringView>)
+            return view.djb2_hash();
+        else
+            return 0;
+    }
+
+    /**
+     * Returns true if the two given StringViews have the same contents.
+     * Null must be passed as the third argument.
+     *
+     * ```
+     * auto str = String("foo-foo");
+     * auto key1 = StringView(&str, 0, 3);
+     * auto key2 = StringView(&str, 4, 3);
+     * auto key3 = StringView("bar");
+     * assert(Hashmap<StringView>::compare_string_view(key1, key2, nullptr));
+     * assert_not(Hashmap<StringView>::compare_string_view(key1, key3, nullptr));
+     * ```
+     */
+    static bool compare_string_view(KeyT &a, KeyT &b, void *) {
+        if constexpr (std::is_same_v<KeyT, TM::StringView>)
+            return a == b;
+        else
+            return false;
+    }
+
     /**
      * Copies the given Hashmap.
      *
@@ -303,11 +355,41 @@ public:
      * auto map2 = Hashmap<String, Thing>(map1);
      * assert_eq(Thing(1), map2.get("foo"));
      * ```
+     *
+     * The bucket array is not allocated until the first put(),
+     * so empty Hashmaps cost zero heap operations, even when copied.
+     *
+     * ```
+     * auto counter = AllocationCounter();
+     * {
+     *     auto map1 = Hashmap<String, Thing>(HashType::TMString);
+     *     auto map2 = Hashmap<String, Thing>(map1);
+     *     auto map3 = Hashmap<String, Thing>(std::move(map2));
+     *     map1 = map3;
+     *     assert(map1.is_empty());
+     *     map1.clear();
+     *     for (std::pair item : map1) {
+     *         (void)item;
+     *     }
+     * }
+     * assert_eq(0, counter.allocations());
+     * assert_eq(0, counter.frees());
+     * ```
+     *
+     * A moved-from Hashmap can be reused.
+     *
+     * ```
+     * auto map1 = Hashmap<String, Thing>(HashType::TMString);
+     * auto map2 = Hashmap<String, Thing>(std::move(map1));
+     * map1.put("foo", Thing(1));
+     * assert_eq(Thing(1), map1.get("foo"));
+     * ```
      */
     Hashmap(const Hashmap &other)
         : m_capacity { other.m_capacity }
         , m_hash_fn { other.m_hash_fn }
         , m_compare_fn { other.m_compare_fn } {
+        if (!other.m_map) return;
         m_map = new Item *[m_capacity] {};
         copy_items_from(other);
     }
@@ -353,9 +435,12 @@ public:
         if (m_map) {
             clear();
             delete[] m_map;
+            m_map = nullptr;
+        }
+        if (other.m_map) {
+            m_map = new Item *[m_capacity] {};
+            copy_items_from(other);
         }
-        m_map = new Item *[m_capacity] {};
-        copy_items_from(other);
         return *this;
     }
 
@@ -459,6 +544,12 @@ public:
      * ```
      */
     T get(KeyT key, void *data = nullptr) const {
+        if (m_size == 0) {
+            if constexpr (std::is_pointer_v<T>)
+                return nullptr;
+            else
+                return {};
+        }
         auto hash = m_hash_fn(key);
         auto item = find_item(key, hash, data);
         if (item)
@@ -510,6 +601,80 @@ public:
         return nullptr;
     }
 
+    /**
+     * Gets a value from a Hashmap<String, ...> using a StringView
+     * as the key, so looking up a slice of a larger buffer does
+     * not need a String to be allocated for it. The map must use
+     * the built-in HashType::TMString functions, since the view
+     * is hashed with StringView::djb2_hash, which matches
+     * String::djb2_hash for the same bytes.
+     *
+     * ```
+     * auto map = Hashmap<String, Thing>(HashType::TMString);
+     * map.put("foo", Thing(1));
+     * map.put("bar", Thing(2));
+     * auto request = String("GET /foo HTTP/1.1");
+     * assert_eq(Thing(1), map.get(StringView(&request, 5, 3)));
+     * assert_eq(Thing(2), map.get(StringView("bar")));
+     * assert_eq(Thing(0), map.get(StringView(&request, 4, 4)));
+     * assert_eq(Thing(0), map.get(StringView()));
+     * map.put("", Thing(3));
+     * assert_eq(Thing(3), map.get(StringView()));
+     *
+     * auto empty_map = Hashmap<String, const char *>(HashType::TMString);
+     * assert_eq(nullptr, empty_map.get(StringView("foo")));
+     * ```
+     *
+     * This method aborts if the map uses other hash functions.
+     *
+     * ```should_abort
+     * auto map = Hashmap<String, Thing>(HashType::Pointer);
+     * map.get(StringView("foo"));
+     * ```
+     */
+    template <typename Key = KeyT>
+    T get(StringView key) const {
+        // This is a template so that get(KeyT) still wins when KeyT is StringView.
+        auto item = find_item<Key>(key, key.djb2_hash());
+        if (item)
+            return item->value;
+        if constexpr (std::is_pointer_v<T>)
+            return nullptr;
+        else
+            return {};
+    }
+
+    /**
+     * Finds and returns an Item* in a Hashmap<String, ...> using
+     * a StringView as the key and its precomputed djb2_hash.
+     * See get(StringView).
+     *
+     * ```
+     * auto map = Hashmap<String, Thing>(HashType::TMString);
+     * map.put("foo", Thing(1));
+     * auto key = StringView("foo.bar", 3);
+     * auto item = map.find_item(key, key.djb2_hash());
+     * assert_eq(Thing(1), item->value);
+     * assert_str_eq("foo", item->key);
+     * key = StringView("bar");
+     * assert_eq(nullptr, map.find_item(key, key.djb2_hash()));
+     * ```
+     */
+    template <typename Key = KeyT>
+    Item *find_item(StringView key, size_t hash) const {
+        static_assert(std::is_same_v<Key, String>, "StringView lookup needs String keys");
+        assert(m_hash_fn == &Hashmap::hash_tm_str && m_compare_fn == &Hashmap::compare_tm_str);
+        if (m_size == 0) return nullptr;
+        assert(m_map);
+        auto item = m_map[index_for_hash(hash)];
+        while (item) {
+            if (hash == item->hash && key == StringView(item->key))
+                return item;
+            item = item->next;
+        }
+        return nullptr;
+    }
+
     /**
      * Sets a key in the Hashmap as if it were a hash set.
      * Use this if you don't care about storing/retrieving values.
@@ -540,8 +705,11 @@ public:
      * pointer, then pass it as the third parameter.
      */
     void put(KeyT key, T value, void *data = nullptr) {
-        if (!m_map)
+        if (!m_map) {
+            if (m_capacity == 0) // moved-from
+                m_capacity = calculate_map_size(0);
             m_map = new Item *[m_capacity] {};
+        }
         if (load_factor() > HASHMAP_MAX_LOAD_FACTOR)
             rehash();
         auto hash = m_hash_fn(key);
@@ -704,7 +872,10 @@ public:
         KeyT key() {
             if (m_item)
                 return m_item->key;
-            return nullptr;
+            if constexpr (std::is_pointer_v<KeyT>)
+                return nullptr;
+            else
+                return {};
         }
 
         T value() {
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <assert.h>
+#include <errno.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "tm/optional.hpp"
+#include "tm/simd.hpp"
+#include "tm/string_view.hpp"
+
+namespace TM {
+
+/**
+ * Reads lines from a file descriptor in large blocks, yielding
+ * each line as a StringView into an internal buffer that is
+ * reused from block to block. Memory use is bounded by the block
+ * size or the longest line, whichever is larger, and reading a
+ * line never allocates once the buffer is big enough.
+ *
+ * Lines are returned without their "\n" or "\r\n" terminator,
+ * like StringView::lines(). A view is only valid until the next
+ * call to next(). The file descriptor is not closed.
+ *
+ * ```
+ * int fds[2];
+ * assert(pipe(fds) == 0);
+ * assert(write(fds[1], "first\r\nsecond\n\nlast", 19) == 19);
+ * close(fds[1]);
+ *
+ * auto reader = LineReader(fds[0], 4);
+ * assert_str_eq("first", reader.next().value());
+ * assert_str_eq("second", reader.next().value());
+ * assert_str_eq("", reader.next().value());
+ * assert_str_eq("last", reader.next().value());
+ * assert_not(reader.next());
+ * assert_eq(0, reader.error());
+ * close(fds[0]);
+ * ```
+ */
+class LineReader {
+public:
+    static constexpr size_t DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+    explicit LineReader(int fd, size_t block_size = DEFAULT_BLOCK_SIZE)
+        : m_fd { fd }
+        , m_buffer { new char[block_size] }
+        , m_capacity { block_size } {
+        assert(block_size > 0);
+    }
+
+    LineReader(const LineReader &) = delete;
+    LineReader &operator=(const LineReader &) = delete;
+
+    ~LineReader() {
+        delete[] m_buffer;
+    }
+
+    /**
+     * Returns the next line, or nothing at the end of the input.
+     * Lines longer than the block size grow the buffer.
+     *
+     * ```
+     * int fds[2];
+     * assert(pipe(fds) == 0);
+     * auto long_line = String(100, 'x');
+     * assert(write(fds[1], long_line.c_str(), 100) == 100);
+     * assert(write(fds[1], "\nend\n", 5) == 5);
+     * close(fds[1]);
+     *
+     * auto reader = LineReader(fds[0], 8);
+     * assert(reader.next().value() == long_line);
+     * assert_str_eq("end", reader.next().value());
+     * assert_not(reader.next());
+     * assert_not(reader.next());
+     * close(fds[0]);
+     * ```
+     *
+     * If reading fails, the input ends early and error()
+     * returns the errno value.
+     *
+     * ```
+     * auto reader = LineReader(-1);
+     * assert_not(reader.next());
+     * assert_eq(EBADF, reader.error());
+     * ```
+     */
+    Optional<StringView> next() {
+        for (;;) {
+            const ssize_t index = SIMD::find(m_buffer + m_scan, m_end - m_scan, '\n');
+            if (index != -1) {
+                const size_t newline = m_scan + index;
+                auto line = line_at(m_start, newline);
+                m_start = m_scan = newline + 1;
+                return line;
+            }
+            m_scan = m_end;
+            if (m_eof) {
+                if (m_start == m_end)
+                    return {};
+                auto line = line_at(m_start, m_end);
+                m_start = m_end;
+                return line;
+            }
+            fill();
+        }
+    }
+
+    // errno from a failed read, or 0.
+    int error() const { return m_error; }
+
+private:
+    StringView line_at(size_t start, size_t end) const {
+        if (end > start && m_buffer[end - 1] == '\r')
+            end--;
+        return StringView { m_buffer + start, end - start };
+    }
+
+    // Moves the partial line to the front of the buffer, growing
+    // it if the line fills it, and reads the next block after it.
+    void fill() {
+        const size_t pending = m_end - m_start;
+        if (m_start > 0) {
+            memmove(m_buffer, m_buffer + m_start, pending);
+            m_start = 0;
+            m_scan = m_end = pending;
+        }
+        if (m_end == m_capacity) {
+            auto buffer = new char[m_capacity * 2];
+            memcpy(buffer, m_buffer, m_end);
+            delete[] m_buffer;
+            m_buffer = buffer;
+            m_capacity *= 2;
+        }
+        ssize_t bytes;
+        do {
+            bytes = read(m_fd, m_buffer + m_end, m_capacity - m_end);
+        } while (bytes == -1 && errno == EINTR);
+        if (bytes <= 0) {
+            if (bytes == -1)
+                m_error = errno;
+            m_eof = true;
+            return;
+        }
+        m_end += bytes;
+    }
+
+    int m_fd;
+    char *m_buffer;
+    size_t m_capacity;
+    size_t m_start { 0 }; // start of the next line
+    size_t m_scan { 0 }; // bytes before this are known to hold no newline
+    size_t m_end { 0 }; // end of the bytes read so far
+    bool m_eof { false };
+    int m_error { 0 };
+};
+
+}
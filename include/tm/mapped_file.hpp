@@ -0,0 +1,243 @@
+#pragma once
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "tm/span.hpp"
+#include "tm/string.hpp"
+#include "tm/string_view.hpp"
+
+namespace TM {
+
+/**
+ * Maps a file into memory read-only, so its contents can be
+ * parsed in place through a StringView instead of being read
+ * into a String. The mapping is removed when the MappedFile
+ * is destroyed, which invalidates any views into it.
+ *
+ * ```
+ * char path[] = "/tmp/tm_mapped_file_XXXXXX";
+ * auto fd = mkstemp(path);
+ * assert(write(fd, "line 1\nline 2\n", 14) == 14);
+ * close(fd);
+ *
+ * auto file = MappedFile(path);
+ * assert(file.is_open());
+ * assert_eq(14, file.size());
+ * size_t count = 0;
+ * for (auto line : file.view().lines()) {
+ *     assert(line.begins_with("line "));
+ *     count++;
+ * }
+ * assert_eq(2, count);
+ * unlink(path);
+ * ```
+ */
+class MappedFile {
+public:
+    // How the contents will be read, passed on to the kernel
+    // with madvise() to tune readahead.
+    enum class Advice {
+        Normal,
+        Sequential,
+        Random,
+    };
+
+    /**
+     * Opens and maps the file at the given path. If that fails,
+     * is_open() returns false and error() holds the errno value.
+     *
+     * ```
+     * auto file = MappedFile("/tmp/tm_mapped_file_does_not_exist");
+     * assert_not(file.is_open());
+     * assert_eq(ENOENT, file.error());
+     * assert(file.view().is_empty());
+     * ```
+     *
+     * Empty files open successfully but map nothing.
+     *
+     * ```
+     * char path[] = "/tmp/tm_mapped_file_XXXXXX";
+     * close(mkstemp(path));
+     * auto file = MappedFile(path, MappedFile::Advice::Random);
+     * assert(file.is_open());
+     * assert_eq(0, file.size());
+     * assert_eq(nullptr, file.data());
+     * unlink(path);
+     * ```
+     */
+    explicit MappedFile(const char *path, Advice advice = Advice::Sequential) {
+        assert(path);
+        const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+        if (fd == -1) {
+            m_error = errno;
+            return;
+        }
+        struct stat st;
+        if (fstat(fd, &st) == -1) {
+            m_error = errno;
+            ::close(fd);
+            return;
+        }
+        const size_t size = st.st_size;
+        if (size > 0) {
+            void *data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED) {
+                m_error = errno;
+                ::close(fd);
+                return;
+            }
+            m_data = static_cast<const char *>(data);
+            m_size = size;
+            advise(advice);
+        }
+        // the mapping stays valid after the descriptor is closed
+        ::close(fd);
+        m_open = true;
+    }
+
+    explicit MappedFile(const String &path, Advice advice = Advice::Sequential)
+        : MappedFile { path.c_str(), advice } { }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    /**
+     * Takes over the mapping of another MappedFile.
+     *
+     * ```
+     * char path[] = "/tmp/tm_mapped_file_XXXXXX";
+     * auto fd = mkstemp(path);
+     * assert(write(fd, "abc", 3) == 3);
+     * close(fd);
+     *
+     * auto file1 = MappedFile(path);
+     * auto file2 = MappedFile(std::move(file1));
+     * assert_not(file1.is_open());
+     * assert_str_eq("abc", file2.view());
+     * unlink(path);
+     * ```
+     */
+    MappedFile(MappedFile &&other)
+        : m_data { other.m_data }
+        , m_size { other.m_size }
+        , m_open { other.m_open }
+        , m_error { other.m_error } {
+        other.m_data = nullptr;
+        other.m_size = 0;
+        other.m_open = false;
+    }
+
+    MappedFile &operator=(MappedFile &&other) {
+        if (this == &other)
+            return *this;
+        unmap();
+        m_data = other.m_data;
+        m_size = other.m_size;
+        m_open = other.m_open;
+        m_error = other.m_error;
+        other.m_data = nullptr;
+        other.m_size = 0;
+        other.m_open = false;
+        return *this;
+    }
+
+    ~MappedFile() {
+        unmap();
+    }
+
+    bool is_open() const { return m_open; }
+
+    // errno from the failed open, fstat or mmap call, or 0.
+    int error() const { return m_error; }
+
+    const char *data() const { return m_data; }
+
+    size_t size() const { return m_size; }
+
+    bool is_empty() const { return m_size == 0; }
+
+    /**
+     * Returns a view of the whole file. The view is only valid
+     * while this MappedFile is alive.
+     *
+     * ```
+     * char path[] = "/tmp/tm_mapped_file_XXXXXX";
+     * auto fd = mkstemp(path);
+     * assert(write(fd, "key=value", 9) == 9);
+     * close(fd);
+     *
+     * auto file = MappedFile(path);
+     * auto view = file.view();
+     * assert_eq(file.data(), view.data());
+     * assert_eq(3, view.find('='));
+     * unlink(path);
+     * ```
+     */
+    StringView view() const {
+        return StringView { m_data, m_size };
+    }
+
+    /**
+     * Returns a Span over the bytes of the file.
+     *
+     * ```
+     * char path[] = "/tmp/tm_mapped_file_XXXXXX";
+     * auto fd = mkstemp(path);
+     * assert(write(fd, "a,b,c", 5) == 5);
+     * close(fd);
+     *
+     * auto file = MappedFile(path);
+     * assert_eq(2, file.span().count(','));
+     * unlink(path);
+     * ```
+     *
+     * Span cannot be empty, so this aborts for an empty file.
+     *
+     * ```should_abort
+     * char path[] = "/tmp/tm_mapped_file_XXXXXX";
+     * close(mkstemp(path));
+     * auto file = MappedFile(path);
+     * unlink(path);
+     * file.span();
+     * ```
+     */
+    Span<char> span() const {
+        return Span<char> { m_data, m_size };
+    }
+
+private:
+    void advise(Advice advice) {
+        // the hints are best-effort, so failures are ignored
+        switch (advice) {
+        case Advice::Normal:
+            break;
+        case Advice::Sequential:
+            madvise(const_cast<char *>(m_data), m_size, MADV_SEQUENTIAL);
+            madvise(const_cast<char *>(m_data), m_size, MADV_WILLNEED);
+            break;
+        case Advice::Random:
+            madvise(const_cast<char *>(m_data), m_size, MADV_RANDOM);
+            break;
+        }
+    }
+
+    void unmap() {
+        if (m_data)
+            munmap(const_cast<char *>(m_data), m_size);
+        m_data = nullptr;
+        m_size = 0;
+    }
+
+    const char *m_data { nullptr };
+    size_t m_size { 0 };
+    bool m_open { false };
+    int m_error { 0 };
+};
+
+}
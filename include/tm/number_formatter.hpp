@@ -0,0 +1,535 @@
+#pragma once
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace TM {
+
+struct NumberFormatter {
+    // "-9223372036854775808" and "18446744073709551615" are both 20 bytes.
+    static constexpr size_t MAX_INT_LENGTH = 20;
+
+    // Longest output is a sign, 17 digits, a decimal point and "e-308".
+    static constexpr size_t MAX_DOUBLE_LENGTH = 32;
+
+    /**
+     * Returns the number of decimal digits in the given number.
+     *
+     * ```
+     * assert_eq(1, NumberFormatter::digit_count(0));
+     * assert_eq(1, NumberFormatter::digit_count(9));
+     * assert_eq(2, NumberFormatter::digit_count(10));
+     * assert_eq(20, NumberFormatter::digit_count(18446744073709551615ULL));
+     * ```
+     */
+    static size_t digit_count(unsigned long long number) {
+        size_t count = 1;
+        for (;;) {
+            if (number < 10) return count;
+            if (number < 100) return count + 1;
+            if (number < 1000) return count + 2;
+            if (number < 10000) return count + 3;
+            number /= 10000;
+            count += 4;
+        }
+    }
+
+    /**
+     * Writes the decimal digits of the given number to the
+     * buffer, which must have room for MAX_INT_LENGTH bytes,
+     * and returns how many were written. No null terminator
+     * is added.
+     *
+     * ```
+     * char buf[NumberFormatter::MAX_INT_LENGTH];
+     * assert_eq(1, NumberFormatter::format_uint(0, buf));
+     * assert_eq('0', buf[0]);
+     * auto length = NumberFormatter::format_uint(18446744073709551615ULL, buf);
+     * assert_eq(20, length);
+     * assert_eq(0, memcmp(buf, "18446744073709551615", 20));
+     * ```
+     */
+    static size_t format_uint(unsigned long long number, char *buf) {
+        const size_t length = digit_count(number);
+        write_digits(number, buf + length);
+        return length;
+    }
+
+    /**
+     * Writes the decimal digits of the given number, preceded
+     * by a minus sign if negative, to the buffer, which must
+     * have room for MAX_INT_LENGTH bytes, and returns how many
+     * bytes were written. No null terminator is added.
+     *
+     * ```
+     * char buf[NumberFormatter::MAX_INT_LENGTH];
+     * auto length = NumberFormatter::format_int(-42, buf);
+     * assert_eq(3, length);
+     * assert_eq(0, memcmp(buf, "-42", 3));
+     * length = NumberFormatter::format_int(-9223372036854775807LL - 1, buf);
+     * assert_eq(20, length);
+     * assert_eq(0, memcmp(buf, "-9223372036854775808", 20));
+     * ```
+     */
+    static size_t format_int(long long number, char *buf) {
+        if (number >= 0)
+            return format_uint(number, buf);
+        *buf = '-';
+        // negate in unsigned space so LLONG_MIN does not overflow
+        return 1 + format_uint(0ULL - (unsigned long long)number, buf + 1);
+    }
+
+    /**
+     * Writes the given double to the buffer, which must have room
+     * for MAX_DOUBLE_LENGTH bytes, using the fewest digits that
+     * read back as the same value, and returns how many bytes were
+     * written. No null terminator is added.
+     *
+     * Digits are generated with the Grisu3 algorithm, which
+     * recognizes the roughly 0.5% of inputs for which it cannot
+     * prove its digits are the shortest and closest. Those are
+     * redone by printing with increasing precision and parsing
+     * each result back, which is slower but exact. Numbers from
+     * 1e-4 up to 1e16 are written in fixed notation and always
+     * have a fractional part; anything else uses an exponent.
+     *
+     * ```
+     * char buf[NumberFormatter::MAX_DOUBLE_LENGTH];
+     * auto format = [&](double number) { return String(buf, NumberFormatter::format_double(number, buf)); };
+     * assert_str_eq("0.0", format(0.0));
+     * assert_str_eq("-0.0", format(-0.0));
+     * assert_str_eq("1.0", format(1.0));
+     * assert_str_eq("0.1", format(0.1));
+     * assert_str_eq("-1.5", format(-1.5));
+     * assert_str_eq("0.30000000000000004", format(0.1 + 0.2));
+     * assert_str_eq("123456.789", format(123456.789));
+     * assert_str_eq("0.0001", format(0.0001));
+     * assert_str_eq("1.0e-05", format(0.00001));
+     * assert_str_eq("1000000000000000.0", format(1e15));
+     * assert_str_eq("1.0e+16", format(1e16));
+     * assert_str_eq("1.2345e+20", format(1.2345e20));
+     * assert_str_eq("1.7976931348623157e+308", format(1.7976931348623157e308));
+     * assert_str_eq("5.0e-324", format(5e-324));
+     * assert_str_eq("Infinity", format(__builtin_inf()));
+     * assert_str_eq("-Infinity", format(-__builtin_inf()));
+     * assert_str_eq("NaN", format(__builtin_nan("")));
+     * ```
+     *
+     * Inputs where Grisu3 gives up still get the shortest digits,
+     * including powers of two, whose lower neighbour is closer.
+     *
+     * ```
+     * char buf[NumberFormatter::MAX_DOUBLE_LENGTH];
+     * auto format = [&](double number) { return String(buf, NumberFormatter::format_double(number, buf)); };
+     * assert_str_eq("3.132231570226741e+16", format(3.132231570226741e16));
+     * assert_str_eq("3.1385508678780135e+57", format(3.1385508678780135e57));
+     * assert_str_eq("3.15723672252789e-156", format(3.15723672252789e-156));
+     * assert_str_eq("-1.801439850948199e+16", format(-1.801439850948199e16));
+     * assert_str_eq("562949953421312.2", format(562949953421312.25));
+     * assert_str_eq("9007199254740992.0", format(9007199254740992.0));
+     * assert_str_eq("2.2250738585072014e-308", format(2.2250738585072014e-308));
+     * assert_str_eq("1.0e+23", format(1e23));
+     * ```
+     */
+    static size_t format_double(double number, char *buf) {
+        uint64_t bits;
+        memcpy(&bits, &number, sizeof(bits));
+        const bool negative = bits >> 63;
+        const uint64_t exponent_bits = (bits >> 52) & 0x7FF;
+        const uint64_t fraction_bits = bits & ((uint64_t(1) << 52) - 1);
+
+        if (exponent_bits == 0x7FF) {
+            if (fraction_bits != 0) {
+                memcpy(buf, "NaN", 3);
+                return 3;
+            }
+            if (negative) {
+                memcpy(buf, "-Infinity", 9);
+                return 9;
+            }
+            memcpy(buf, "Infinity", 8);
+            return 8;
+        }
+
+        char *out = buf;
+        if (negative)
+            *out++ = '-';
+
+        if (exponent_bits == 0 && fraction_bits == 0) {
+            memcpy(out, "0.0", 3);
+            return out - buf + 3;
+        }
+
+        char digits[18];
+        int digit_length = 0;
+        int decimal_exponent = 0;
+        if (!grisu3(exponent_bits, fraction_bits, digits, digit_length, decimal_exponent))
+            shortest_digits_slow(negative ? -number : number, fraction_bits == 0 && exponent_bits > 1, digits, digit_length, decimal_exponent);
+
+        // position of the decimal point relative to the first digit
+        const int point = digit_length + decimal_exponent;
+
+        if (point > -4 && point <= 16) {
+            if (point <= 0) {
+                // 0.000ddd
+                *out++ = '0';
+                *out++ = '.';
+                memset(out, '0', -point);
+                out += -point;
+                memcpy(out, digits, digit_length);
+                out += digit_length;
+            } else if (point < digit_length) {
+                // ddd.ddd
+                memcpy(out, digits, point);
+                out += point;
+                *out++ = '.';
+                memcpy(out, digits + point, digit_length - point);
+                out += digit_length - point;
+            } else {
+                // ddd000.0
+                memcpy(out, digits, digit_length);
+                out += digit_length;
+                memset(out, '0', point - digit_length);
+                out += point - digit_length;
+                *out++ = '.';
+                *out++ = '0';
+            }
+            return out - buf;
+        }
+
+        // d.ddde+XX
+        *out++ = digits[0];
+        *out++ = '.';
+        if (digit_length > 1) {
+            memcpy(out, digits + 1, digit_length - 1);
+            out += digit_length - 1;
+        } else {
+            *out++ = '0';
+        }
+        *out++ = 'e';
+        int exponent = point - 1;
+        if (exponent < 0) {
+            *out++ = '-';
+            exponent = -exponent;
+        } else {
+            *out++ = '+';
+        }
+        if (exponent >= 100) {
+            *out++ = '0' + exponent / 100;
+            exponent %= 100;
+        }
+        memcpy(out, digit_pairs() + exponent * 2, 2);
+        return out - buf + 2;
+    }
+
+private:
+    static const char *digit_pairs() {
+        return "00010203040506070809"
+               "10111213141516171819"
+               "20212223242526272829"
+               "30313233343536373839"
+               "40414243444546474849"
+               "50515253545556575859"
+               "60616263646566676869"
+               "70717273747576777879"
+               "80818283848586878889"
+               "90919293949596979899";
+    }
+
+    // Writes the digits of number so that the last one lands just before end.
+    static void write_digits(unsigned long long number, char *end) {
+        const char *pairs = digit_pairs();
+        while (number >= 100) {
+            const auto pair = (number % 100) * 2;
+            number /= 100;
+            end -= 2;
+            memcpy(end, pairs + pair, 2);
+        }
+        if (number >= 10)
+            memcpy(end - 2, pairs + number * 2, 2);
+        else
+            *(end - 1) = '0' + number;
+    }
+
+    // A floating-point number f * 2^e with a 64-bit significand.
+    struct DiyFp {
+        uint64_t f;
+        int e;
+
+        DiyFp operator-(const DiyFp &other) const {
+            assert(e == other.e && f >= other.f);
+            return { f - other.f, e };
+        }
+
+        // Returns the upper 64 bits of the 128-bit product, rounded.
+        DiyFp operator*(const DiyFp &other) const {
+            const uint64_t a = f >> 32, b = f & 0xFFFFFFFF;
+            const uint64_t c = other.f >> 32, d = other.f & 0xFFFFFFFF;
+            const uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+            uint64_t mid = (bd >> 32) + (ad & 0xFFFFFFFF) + (bc & 0xFFFFFFFF);
+            mid += uint64_t(1) << 31;
+            return { ac + (ad >> 32) + (bc >> 32) + (mid >> 32), e + other.e + 64 };
+        }
+
+        DiyFp normalized() const {
+            const int shift = __builtin_clzll(f);
+            return { f << shift, e - shift };
+        }
+    };
+
+    struct CachedPower {
+        uint64_t f;
+        int e;
+        int k;
+    };
+
+    // Digits are generated while the scaled number's binary exponent
+    // is in this range, so its integral part fits in 32 bits.
+    static constexpr int ALPHA = -60;
+    static constexpr int GAMMA = -32;
+
+    // Returns a power of ten 10^-k = f * 2^e such that multiplying a
+    // number with the given binary exponent by it lands in [ALPHA, GAMMA].
+    static CachedPower cached_power_for(int binary_exponent) {
+        // 10^k for k = -300, -292, ..., 324, normalized and rounded.
+        static const CachedPower powers[] = {
+            { 0xAB70FE17C79AC6CA, -1060, -300 },
+            { 0xFF77B1FCBEBCDC4F, -1034, -292 },
+            { 0xBE5691EF416BD60C, -1007, -284 },
+            { 0x8DD01FAD907FFC3C, -980, -276 },
+            { 0xD3515C2831559A83, -954, -268 },
+            { 0x9D71AC8FADA6C9B5, -927, -260 },
+            { 0xEA9C227723EE8BCB, -901, -252 },
+            { 0xAECC49914078536D, -874, -244 },
+            { 0x823C12795DB6CE57, -847, -236 },
+            { 0xC21094364DFB5637, -821, -228 },
+            { 0x9096EA6F3848984F, -794, -220 },
+            { 0xD77485CB25823AC7, -768, -212 },
+            { 0xA086CFCD97BF97F4, -741, -204 },
+            { 0xEF340A98172AACE5, -715, -196 },
+            { 0xB23867FB2A35B28E, -688, -188 },
+            { 0x84C8D4DFD2C63F3B, -661, -180 },
+            { 0xC5DD44271AD3CDBA, -635, -172 },
+            { 0x936B9FCEBB25C996, -608, -164 },
+            { 0xDBAC6C247D62A584, -582, -156 },
+            { 0xA3AB66580D5FDAF6, -555, -148 },
+            { 0xF3E2F893DEC3F126, -529, -140 },
+            { 0xB5B5ADA8AAFF80B8, -502, -132 },
+            { 0x87625F056C7C4A8B, -475, -124 },
+            { 0xC9BCFF6034C13053, -449, -116 },
+            { 0x964E858C91BA2655, -422, -108 },
+            { 0xDFF9772470297EBD, -396, -100 },
+            { 0xA6DFBD9FB8E5B88F, -369, -92 },
+            { 0xF8A95FCF88747D94, -343, -84 },
+            { 0xB94470938FA89BCF, -316, -76 },
+            { 0x8A08F0F8BF0F156B, -289, -68 },
+            { 0xCDB02555653131B6, -263, -60 },
+            { 0x993FE2C6D07B7FAC, -236, -52 },
+            { 0xE45C10C42A2B3B06, -210, -44 },
+            { 0xAA242499697392D3, -183, -36 },
+            { 0xFD87B5F28300CA0E, -157, -28 },
+            { 0xBCE5086492111AEB, -130, -20 },
+            { 0x8CBCCC096F5088CC, -103, -12 },
+            { 0xD1B71758E219652C, -77, -4 },
+            { 0x9C40000000000000, -50, 4 },
+            { 0xE8D4A51000000000, -24, 12 },
+            { 0xAD78EBC5AC620000, 3, 20 },
+            { 0x813F3978F8940984, 30, 28 },
+            { 0xC097CE7BC90715B3, 56, 36 },
+            { 0x8F7E32CE7BEA5C70, 83, 44 },
+            { 0xD5D238A4ABE98068, 109, 52 },
+            { 0x9F4F2726179A2245, 136, 60 },
+            { 0xED63A231D4C4FB27, 162, 68 },
+            { 0xB0DE65388CC8ADA8, 189, 76 },
+            { 0x83C7088E1AAB65DB, 216, 84 },
+            { 0xC45D1DF942711D9A, 242, 92 },
+            { 0x924D692CA61BE758, 269, 100 },
+            { 0xDA01EE641A708DEA, 295, 108 },
+            { 0xA26DA3999AEF774A, 322, 116 },
+            { 0xF209787BB47D6B85, 348, 124 },
+            { 0xB454E4A179DD1877, 375, 132 },
+            { 0x865B86925B9BC5C2, 402, 140 },
+            { 0xC83553C5C8965D3D, 428, 148 },
+            { 0x952AB45CFA97A0B3, 455, 156 },
+            { 0xDE469FBD99A05FE3, 481, 164 },
+            { 0xA59BC234DB398C25, 508, 172 },
+            { 0xF6C69A72A3989F5C, 534, 180 },
+            { 0xB7DCBF5354E9BECE, 561, 188 },
+            { 0x88FCF317F22241E2, 588, 196 },
+            { 0xCC20CE9BD35C78A5, 614, 204 },
+            { 0x98165AF37B2153DF, 641, 212 },
+            { 0xE2A0B5DC971F303A, 667, 220 },
+            { 0xA8D9D1535CE3B396, 694, 228 },
+            { 0xFB9B7CD9A4A7443C, 720, 236 },
+            { 0xBB764C4CA7A44410, 747, 244 },
+            { 0x8BAB8EEFB6409C1A, 774, 252 },
+            { 0xD01FEF10A657842C, 800, 260 },
+            { 0x9B10A4E5E9913129, 827, 268 },
+            { 0xE7109BFBA19C0C9D, 853, 276 },
+            { 0xAC2820D9623BF429, 880, 284 },
+            { 0x80444B5E7AA7CF85, 907, 292 },
+            { 0xBF21E44003ACDD2D, 933, 300 },
+            { 0x8E679C2F5E44FF8F, 960, 308 },
+            { 0xD433179D9C8CB841, 986, 316 },
+            { 0x9E19DB92B4E31BA9, 1013, 324 },
+        };
+        constexpr int min_decimal_exponent = -300;
+        constexpr int decimal_step = 8;
+        // ceil(log10(2) * (ALPHA - binary_exponent - 1)), with 78913 / 2^18 ~= log10(2)
+        const int f = ALPHA - binary_exponent - 1;
+        const int k = (f * 78913) / (1 << 18) + (f > 0);
+        const int index = (-min_decimal_exponent + k + (decimal_step - 1)) / decimal_step;
+        assert(index >= 0 && (size_t)index < sizeof(powers) / sizeof(powers[0]));
+        const auto cached = powers[index];
+        assert(ALPHA <= cached.e + binary_exponent + 64 && cached.e + binary_exponent + 64 <= GAMMA);
+        return cached;
+    }
+
+    // Returns the number of digits in n and sets power to 10^(digits - 1).
+    static int largest_power_of_ten(uint32_t n, uint32_t &power) {
+        int digits = 10;
+        power = 1000000000;
+        while (power > n && digits > 1) {
+            power /= 10;
+            digits--;
+        }
+        return digits;
+    }
+
+    // Moves the last digit closer to w, which lies distance below the top
+    // of the interval, give or take unit. Returns false if the digit that
+    // is closest cannot be told apart, or if the result could fall outside
+    // the interval (of size delta) once the error in unit is accounted for.
+    static bool round_last_digit(char *digits, int length, uint64_t distance, uint64_t delta, uint64_t rest, uint64_t ten_k, uint64_t unit) {
+        const uint64_t small_distance = distance - unit;
+        const uint64_t big_distance = distance + unit;
+        while (rest < small_distance && delta - rest >= ten_k && (rest + ten_k < small_distance || small_distance - rest >= rest + ten_k - small_distance)) {
+            digits[length - 1]--;
+            rest += ten_k;
+        }
+        if (rest < big_distance && delta - rest >= ten_k && (rest + ten_k < big_distance || big_distance - rest > rest + ten_k - big_distance))
+            return false;
+        return 2 * unit <= rest && rest <= delta - 4 * unit;
+    }
+
+    // Generates the shortest digits that are inside the rounding interval
+    // of the given double, or returns false if the limited precision of
+    // the arithmetic means they cannot be proven to be.
+    static bool grisu3(uint64_t exponent_bits, uint64_t fraction_bits, char *digits, int &length, int &decimal_exponent) {
+        constexpr int exponent_bias = 1075; // 1023 + 52 fraction bits
+        const DiyFp v = exponent_bits == 0
+            ? DiyFp { fraction_bits, 1 - exponent_bias }
+            : DiyFp { fraction_bits + (uint64_t(1) << 52), (int)exponent_bits - exponent_bias };
+
+        // Boundaries halfway to the neighbouring doubles. The lower neighbour
+        // is closer when v is a power of two, since the exponent steps down.
+        const bool lower_is_closer = fraction_bits == 0 && exponent_bits > 1;
+        const DiyFp upper = DiyFp { 2 * v.f + 1, v.e - 1 }.normalized();
+        DiyFp lower = lower_is_closer ? DiyFp { 4 * v.f - 1, v.e - 2 } : DiyFp { 2 * v.f - 1, v.e - 1 };
+        lower = { lower.f << (lower.e - upper.e), upper.e };
+
+        const auto cached = cached_power_for(upper.e);
+        const DiyFp c_minus_k { cached.f, cached.e };
+        const DiyFp w = v.normalized() * c_minus_k;
+        const DiyFp w_lower = lower * c_minus_k;
+        const DiyFp w_upper = upper * c_minus_k;
+
+        // Each product is off by at most one unit, so widen the interval by
+        // one unit and only accept digits that are safely inside it.
+        uint64_t unit = 1;
+        const DiyFp too_low { w_lower.f - unit, w_lower.e };
+        const DiyFp too_high { w_upper.f + unit, w_upper.e };
+        uint64_t delta = (too_high - too_low).f;
+        const uint64_t distance = (too_high - w).f;
+
+        const DiyFp one { uint64_t(1) << -w.e, w.e };
+        uint32_t integral = (uint32_t)(too_high.f >> -one.e);
+        uint64_t fractional = too_high.f & (one.f - 1);
+
+        decimal_exponent = -cached.k;
+        length = 0;
+
+        uint32_t power;
+        int n = largest_power_of_ten(integral, power);
+        while (n > 0) {
+            digits[length++] = '0' + integral / power;
+            integral %= power;
+            n--;
+            const uint64_t rest = (uint64_t(integral) << -one.e) + fractional;
+            if (rest < delta) {
+                decimal_exponent += n;
+                return round_last_digit(digits, length, distance, delta, rest, uint64_t(power) << -one.e, unit);
+            }
+            power /= 10;
+        }
+
+        int m = 0;
+        for (;;) {
+            fractional *= 10;
+            unit *= 10;
+            delta *= 10;
+            digits[length++] = '0' + (fractional >> -one.e);
+            fractional &= one.f - 1;
+            m++;
+            if (fractional < delta)
+                break;
+        }
+        decimal_exponent -= m;
+        return round_last_digit(digits, length, distance * unit, delta, fractional, one.f, unit);
+    }
+
+    // Finds the shortest digits for the given positive double by printing it
+    // with more and more precision until the result parses back to it. The
+    // digits printed are the nearest ones, which always work when the
+    // interval is symmetric. When the lower neighbour is closer, the next
+    // digits up may still be inside the wider upper half when they are not.
+    static void shortest_digits_slow(double number, bool lower_is_closer, char *digits, int &length, int &decimal_exponent) {
+        for (int precision = 1;; precision++) {
+            char printed[32];
+            snprintf(printed, sizeof(printed), "%.*e", precision - 1, number);
+            const char *c = printed;
+            length = 0;
+            for (; *c != 'e'; c++) {
+                if (*c >= '0' && *c <= '9')
+                    digits[length++] = *c;
+            }
+            decimal_exponent = atoi(c + 1) - (length - 1);
+            if (reads_back_as(number, digits, length, decimal_exponent))
+                break;
+            if (lower_is_closer) {
+                char next[18];
+                memcpy(next, digits, length);
+                int i = length - 1;
+                for (; i >= 0 && next[i] == '9'; i--)
+                    next[i] = '0';
+                if (i >= 0) {
+                    next[i]++;
+                    if (reads_back_as(number, next, length, decimal_exponent)) {
+                        memcpy(digits, next, length);
+                        break;
+                    }
+                }
+            }
+            assert(precision < 17);
+        }
+        while (length > 1 && digits[length - 1] == '0') {
+            length--;
+            decimal_exponent++;
+        }
+    }
+
+    // Checks if the given digits times 10^decimal_exponent parse as number.
+    static bool reads_back_as(double number, const char *digits, int length, int decimal_exponent) {
+        // no decimal point, so the result does not depend on the locale
+        char text[32];
+        memcpy(text, digits, length);
+        snprintf(text + length, sizeof(text) - length, "e%d", decimal_exponent);
+        return strtod(text, nullptr) == number;
+    }
+};
+
+}
@@ -0,0 +1,254 @@
+#pragma once
+
+#include <assert.h>
+#include <errno.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "tm/number_formatter.hpp"
+#include "tm/rope.hpp"
+#include "tm/string.hpp"
+#include "tm/string_view.hpp"
+
+namespace TM {
+
+/**
+ * Collects output in a fixed-size buffer and hands it to the
+ * file descriptor in large blocks. Writes that are larger than
+ * the buffer are passed straight through with writev(), together
+ * with whatever was already buffered, so big payloads are never
+ * copied. Anything still buffered is flushed on destruction.
+ *
+ * ```
+ * int fds[2];
+ * assert(pipe(fds) == 0);
+ * {
+ *     auto out = OutputBuffer(fds[1]);
+ *     out.write("count: ");
+ *     out.write_int(-42);
+ *     out.write(' ');
+ *     out.write(String("done"));
+ *     assert_eq(0, out.bytes_written());
+ * }
+ * char buf[32] = {};
+ * assert_eq(15, read(fds[0], buf, sizeof(buf)));
+ * assert_str_eq("count: -42 done", String(buf));
+ * close(fds[0]);
+ * close(fds[1]);
+ * ```
+ */
+class OutputBuffer {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 64 * 1024;
+
+    explicit OutputBuffer(int fd, size_t capacity = DEFAULT_CAPACITY)
+        : m_fd { fd }
+        , m_buffer { new char[capacity] }
+        , m_capacity { capacity } {
+        assert(capacity >= NumberFormatter::MAX_DOUBLE_LENGTH);
+    }
+
+    OutputBuffer(const OutputBuffer &) = delete;
+    OutputBuffer &operator=(const OutputBuffer &) = delete;
+
+    ~OutputBuffer() {
+        flush();
+        delete[] m_buffer;
+    }
+
+    /**
+     * Writes the given bytes, buffering them if they fit.
+     *
+     * ```
+     * int fds[2];
+     * assert(pipe(fds) == 0);
+     * auto out = OutputBuffer(fds[1], 32);
+     * out.write("0123456789", 10);
+     * assert_eq(10, out.size());
+     * auto big = String(100, 'x');
+     * out.write(big.c_str(), big.size());
+     * assert_eq(0, out.size());
+     * assert_eq(110, out.bytes_written());
+     * char buf[128] = {};
+     * assert_eq(110, read(fds[0], buf, sizeof(buf)));
+     * assert_eq('9', buf[9]);
+     * assert_eq('x', buf[109]);
+     * close(fds[0]);
+     * close(fds[1]);
+     * ```
+     */
+    void write(const char *data, size_t size) {
+        if (size <= m_capacity - m_size) {
+            if (size > 0)
+                memcpy(m_buffer + m_size, data, size);
+            m_size += size;
+            return;
+        }
+        if (size < m_capacity) {
+            flush();
+            memcpy(m_buffer, data, size);
+            m_size = size;
+            return;
+        }
+        struct iovec iov[2] = {
+            { m_buffer, m_size },
+            { const_cast<char *>(data), size },
+        };
+        write_all(iov, 2);
+        m_size = 0;
+    }
+
+    void write(const char *str) {
+        assert(str);
+        write(str, strlen(str));
+    }
+
+    void write(const String &str) {
+        write(str.c_str(), str.size());
+    }
+
+    void write(StringView view) {
+        write(view.data(), view.size());
+    }
+
+    void write(char c) {
+        if (m_size == m_capacity)
+            flush();
+        m_buffer[m_size++] = c;
+    }
+
+    /**
+     * Writes every chunk of the given Rope, without flattening it.
+     *
+     * ```
+     * int fds[2];
+     * assert(pipe(fds) == 0);
+     * auto rope = Rope("hello ");
+     * rope.append(String(100, '.'));
+     * rope.append(" world");
+     * auto out = OutputBuffer(fds[1], 64);
+     * out.write(rope);
+     * out.flush();
+     * char buf[128] = {};
+     * assert_eq(112, read(fds[0], buf, sizeof(buf)));
+     * assert(rope.to_string() == String(buf));
+     * close(fds[0]);
+     * close(fds[1]);
+     * ```
+     */
+    void write(const Rope &rope) {
+        for (auto chunk : rope.chunks())
+            write(chunk.str, chunk.size);
+    }
+
+    /**
+     * Writes the decimal digits of the given number directly
+     * into the buffer.
+     *
+     * ```
+     * int fds[2];
+     * assert(pipe(fds) == 0);
+     * auto out = OutputBuffer(fds[1]);
+     * out.write_int(LLONG_MIN);
+     * out.write(',');
+     * out.write_uint(ULLONG_MAX);
+     * out.write(',');
+     * out.write_double(0.1);
+     * out.flush();
+     * char buf[64] = {};
+     * assert(read(fds[0], buf, sizeof(buf)) > 0);
+     * assert_str_eq("-9223372036854775808,18446744073709551615,0.1", String(buf));
+     * close(fds[0]);
+     * close(fds[1]);
+     * ```
+     */
+    void write_int(long long number) {
+        reserve(NumberFormatter::MAX_INT_LENGTH);
+        m_size += NumberFormatter::format_int(number, m_buffer + m_size);
+    }
+
+    void write_uint(unsigned long long number) {
+        reserve(NumberFormatter::MAX_INT_LENGTH);
+        m_size += NumberFormatter::format_uint(number, m_buffer + m_size);
+    }
+
+    // See NumberFormatter::format_double for the format.
+    void write_double(double number) {
+        reserve(NumberFormatter::MAX_DOUBLE_LENGTH);
+        m_size += NumberFormatter::format_double(number, m_buffer + m_size);
+    }
+
+    /**
+     * Hands everything buffered to the file descriptor. Returns
+     * false if writing failed, in which case error() holds the
+     * errno value and the buffered bytes are dropped.
+     *
+     * ```
+     * auto out = OutputBuffer(-1);
+     * out.write("lost");
+     * assert_not(out.flush());
+     * assert_eq(EBADF, out.error());
+     * assert_eq(0, out.size());
+     * ```
+     */
+    bool flush() {
+        if (m_size == 0)
+            return m_error == 0;
+        struct iovec iov = { m_buffer, m_size };
+        write_all(&iov, 1);
+        m_size = 0;
+        return m_error == 0;
+    }
+
+    // Number of bytes waiting in the buffer.
+    size_t size() const { return m_size; }
+
+    // Number of bytes handed to the file descriptor so far.
+    size_t bytes_written() const { return m_bytes_written; }
+
+    // errno from the first failed write, or 0.
+    int error() const { return m_error; }
+
+private:
+    void reserve(size_t size) {
+        if (m_capacity - m_size < size)
+            flush();
+    }
+
+    void write_all(struct iovec *iov, int count) {
+        if (m_error)
+            return;
+        while (count > 0) {
+            const ssize_t written = writev(m_fd, iov, count);
+            if (written == -1) {
+                if (errno == EINTR)
+                    continue;
+                m_error = errno;
+                return;
+            }
+            m_bytes_written += written;
+            // skip the fully written entries and advance into a partial one
+            size_t remaining = written;
+            while (count > 0 && remaining >= iov->iov_len) {
+                remaining -= iov->iov_len;
+                iov++;
+                count--;
+            }
+            if (count > 0) {
+                iov->iov_base = static_cast<char *>(iov->iov_base) + remaining;
+                iov->iov_len -= remaining;
+            }
+        }
+    }
+
+    int m_fd;
+    char *m_buffer;
+    size_t m_capacity;
+    size_t m_size { 0 };
+    size_t m_bytes_written { 0 };
+    int m_error { 0 };
+};
+
+}
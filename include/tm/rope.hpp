@@ -0,0 +1,477 @@
+#pragma once
+
+#include <assert.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "tm/shared_ptr.hpp"
+#include "tm/string.hpp"
+#include "tm/vector.hpp"
+
+namespace TM {
+
+/**
+ * A string stored as a balanced tree of immutable chunks.
+ * Concatenation, slicing and indexing take O(log n) time and
+ * never copy more than a small leaf, which makes a Rope a good
+ * fit for building large outputs piece by piece. The contents
+ * are only flattened into a single String when asked for.
+ *
+ * Copying a Rope shares its tree, since nodes are never
+ * modified once built.
+ *
+ * ```
+ * auto rope = Rope("world");
+ * rope.prepend("hello ");
+ * rope.append("!");
+ * assert_eq(12, rope.size());
+ * assert_eq('w', rope[6]);
+ * assert_str_eq("hello world!", rope.to_string());
+ * ```
+ */
+class Rope {
+    struct Node;
+
+public:
+    // Adjacent leaves are merged into one when their combined
+    // size does not exceed this, to keep small appends from
+    // creating a node per call.
+    static constexpr size_t LEAF_MERGE_LIMIT = 512;
+
+    /**
+     * Constructs an empty Rope.
+     *
+     * ```
+     * auto rope = Rope();
+     * assert_eq(0, rope.size());
+     * assert(rope.is_empty());
+     * ```
+     */
+    Rope() { }
+
+    /**
+     * Constructs a Rope holding the contents of the given String.
+     * The String buffer is shared rather than copied.
+     *
+     * ```
+     * auto str = String("foo");
+     * auto rope = Rope(str);
+     * assert_str_eq("foo", rope.to_string());
+     * ```
+     */
+    Rope(const String &str)
+        : m_root { make_leaf(str, 0, str.size()) } { }
+
+    /**
+     * Constructs a Rope by copying the given C string.
+     *
+     * ```
+     * auto rope = Rope("foo");
+     * assert_eq(3, rope.size());
+     * ```
+     */
+    Rope(const char *str)
+        : Rope { String(str) } { }
+
+    /**
+     * Constructs a Rope by copying the given number of bytes.
+     *
+     * ```
+     * auto rope = Rope("foo\0bar", 7);
+     * assert_eq(7, rope.size());
+     * assert_eq('\0', rope[3]);
+     * ```
+     */
+    Rope(const char *str, size_t length)
+        : Rope { String(str, length) } { }
+
+    /**
+     * Returns the number of bytes in the Rope.
+     *
+     * ```
+     * auto rope = Rope("foo");
+     * rope.append("bar");
+     * assert_eq(6, rope.size());
+     * ```
+     */
+    size_t size() const { return m_root ? m_root->size : 0; }
+
+    bool is_empty() const { return size() == 0; }
+
+    /**
+     * Returns the height of the tree. A Rope with a single
+     * chunk has height 1.
+     *
+     * ```
+     * auto rope = Rope();
+     * for (int i = 0; i < 1000; i++)
+     *     rope.append(String(1000, 'x'));
+     * assert(rope.height() <= 15);
+     * ```
+     */
+    size_t height() const { return height(m_root); }
+
+    /**
+     * Returns the byte at the given index.
+     *
+     * ```
+     * auto rope = Rope("foo");
+     * rope.append(String(1000, 'x'));
+     * rope.append("bar");
+     * assert_eq('f', rope.at(0));
+     * assert_eq('x', rope.at(3));
+     * assert_eq('r', rope.at(1005));
+     * ```
+     *
+     * This method aborts if the index is past the end.
+     *
+     * ```should_abort
+     * auto rope = Rope("foo");
+     * rope.at(3);
+     * ```
+     */
+    char at(size_t index) const {
+        assert(index < size());
+        const Node *node = &*m_root;
+        while (!node->is_leaf()) {
+            const size_t left_size = node->left->size;
+            if (index < left_size) {
+                node = &*node->left;
+            } else {
+                index -= left_size;
+                node = &*node->right;
+            }
+        }
+        return node->data()[index];
+    }
+
+    char operator[](size_t index) const { return at(index); }
+
+    /**
+     * Returns a new Rope with the other Rope's contents after
+     * this one's. Neither Rope is modified.
+     *
+     * ```
+     * auto rope1 = Rope("foo");
+     * auto rope2 = Rope("bar");
+     * auto rope3 = rope1 + rope2;
+     * assert_str_eq("foobar", rope3.to_string());
+     * assert_str_eq("foo", rope1.to_string());
+     * ```
+     */
+    Rope operator+(const Rope &other) const {
+        return Rope { join(m_root, other.m_root) };
+    }
+
+    /**
+     * Appends the given Rope (or String, or C string).
+     *
+     * ```
+     * auto rope = Rope("foo");
+     * rope.append(Rope("bar"));
+     * rope.append(String("baz"));
+     * rope.append("!");
+     * assert_str_eq("foobarbaz!", rope.to_string());
+     * ```
+     */
+    void append(const Rope &other) {
+        m_root = join(m_root, other.m_root);
+    }
+
+    /**
+     * Prepends the given Rope (or String, or C string). Unlike
+     * String::prepend(), existing contents are not moved.
+     *
+     * ```
+     * auto rope = Rope();
+     * for (int i = 0; i < 1000; i++)
+     *     rope.prepend(String(i % 10));
+     * assert_eq(1000, rope.size());
+     * assert_eq('9', rope[0]);
+     * assert_eq('0', rope[999]);
+     * ```
+     */
+    void prepend(const Rope &other) {
+        m_root = join(other.m_root, m_root);
+    }
+
+    /**
+     * Returns a Rope covering the given range. The result shares
+     * chunks with this Rope, so no bytes are copied apart from
+     * merged leaves at the edges.
+     *
+     * ```
+     * auto rope = Rope("hello ");
+     * rope.append(String(1000, 'x'));
+     * rope.append("world");
+     * assert_str_eq("lo xx", rope.substring(3, 5).to_string());
+     * assert_str_eq("xxworld", rope.substring(1004, 7).to_string());
+     * assert_eq(1011, rope.substring(0, 1011).size());
+     * ```
+     *
+     * This method aborts if the given start index is past the end.
+     *
+     * ```should_abort
+     * auto rope = Rope("abc");
+     * rope.substring(3, 1);
+     * ```
+     *
+     * ...and if the resulting end index (start + length) is past the end.
+     *
+     * ```should_abort
+     * auto rope = Rope("abc");
+     * rope.substring(1, 3);
+     * ```
+     */
+    Rope substring(size_t start, size_t length) const {
+        assert(start < size());
+        assert(start + length <= size());
+        return Rope { slice(m_root, start, length) };
+    }
+
+    /**
+     * Returns a Rope covering everything from the given
+     * start index to the end.
+     *
+     * ```
+     * auto rope = Rope("foo");
+     * rope.append("bar");
+     * assert_str_eq("obar", rope.substring(2).to_string());
+     * ```
+     */
+    Rope substring(size_t start) const {
+        return substring(start, size() - start);
+    }
+
+    /**
+     * Copies the contents into a new String.
+     *
+     * ```
+     * auto rope = Rope("foo");
+     * rope.append("bar");
+     * assert_str_eq("foobar", rope.to_string());
+     * assert_str_eq("", Rope().to_string());
+     * ```
+     */
+    String to_string() const {
+        if (!m_root)
+            return String();
+        if (m_root->is_leaf() && m_root->offset == 0 && m_root->size == m_root->str.size())
+            return m_root->str;
+        auto buf = new char[size() + 1];
+        size_t offset = 0;
+        for (auto chunk : chunks()) {
+            memcpy(buf + offset, chunk.str, chunk.size);
+            offset += chunk.size;
+        }
+        buf[offset] = '\0';
+        return String::create_and_take_ownership(buf, offset);
+    }
+
+    /**
+     * Replaces the tree with a single chunk holding all of the
+     * contents, which speeds up later indexing.
+     *
+     * ```
+     * auto rope = Rope("foo");
+     * rope.append(String(1000, 'x'));
+     * rope.flatten();
+     * assert_eq(1, rope.height());
+     * assert_eq(1003, rope.size());
+     * ```
+     */
+    void flatten() {
+        if (height() > 1)
+            m_root = make_leaf(to_string(), 0, size());
+    }
+
+    struct Chunk {
+        const char *str;
+        size_t size;
+    };
+
+    class ChunkIterator {
+    public:
+        ChunkIterator() { }
+
+        ChunkIterator(const Node *root) {
+            if (root)
+                descend(root);
+        }
+
+        Chunk operator*() const {
+            return { m_leaf->data(), m_leaf->size };
+        }
+
+        ChunkIterator &operator++() {
+            if (m_pending.is_empty())
+                m_leaf = nullptr;
+            else
+                descend(&*m_pending.pop()->right);
+            return *this;
+        }
+
+        friend bool operator==(const ChunkIterator &i1, const ChunkIterator &i2) {
+            return i1.m_leaf == i2.m_leaf && i1.m_pending.size() == i2.m_pending.size();
+        }
+
+        friend bool operator!=(const ChunkIterator &i1, const ChunkIterator &i2) {
+            return !(i1 == i2);
+        }
+
+    private:
+        void descend(const Node *node) {
+            while (!node->is_leaf()) {
+                m_pending.push(node);
+                node = &*node->left;
+            }
+            m_leaf = node;
+        }
+
+        const Node *m_leaf { nullptr };
+
+        // branches whose right subtree has not been visited yet
+        Vector<const Node *> m_pending {};
+    };
+
+    class Chunks {
+    public:
+        Chunks(const SharedPtr<Node> &root)
+            : m_root { root } { }
+
+        ChunkIterator begin() const { return ChunkIterator { m_root ? &*m_root : nullptr }; }
+        ChunkIterator end() const { return ChunkIterator {}; }
+
+    private:
+        // keeps the tree alive while it is being iterated
+        SharedPtr<Node> m_root;
+    };
+
+    /**
+     * Returns a range over the chunks of the Rope in order,
+     * suitable for handing to writev() or fwrite() without
+     * flattening first.
+     *
+     * ```
+     * auto rope = Rope("foo");
+     * rope.append(String(1000, 'x'));
+     * rope.append(String(1000, 'y'));
+     * auto str = String();
+     * size_t count = 0;
+     * for (auto chunk : rope.chunks()) {
+     *     str.append(chunk.str, chunk.size);
+     *     count++;
+     * }
+     * assert_eq(3, count);
+     * assert(str == rope.to_string());
+     *
+     * auto empty = Rope();
+     * assert(empty.chunks().begin() == empty.chunks().end());
+     * ```
+     */
+    Chunks chunks() const { return Chunks { m_root }; }
+
+private:
+    // A leaf refers to a range of a String; a branch has two
+    // children and no bytes of its own.
+    struct Node {
+        SharedPtr<Node> left {};
+        SharedPtr<Node> right {};
+        String str {};
+        size_t offset { 0 };
+        size_t size { 0 };
+        size_t height { 1 };
+
+        bool is_leaf() const { return !left; }
+        const char *data() const { return str.c_str() + offset; }
+    };
+
+    using NodePtr = SharedPtr<Node>;
+
+    Rope(NodePtr root)
+        : m_root { root } { }
+
+    static size_t height(const NodePtr &node) {
+        return node ? node->height : 0;
+    }
+
+    static NodePtr make_leaf(const String &str, size_t offset, size_t size) {
+        if (size == 0)
+            return {};
+        auto node = new Node;
+        node->str = str;
+        node->offset = offset;
+        node->size = size;
+        return node;
+    }
+
+    static NodePtr make_branch(const NodePtr &left, const NodePtr &right) {
+        auto node = new Node;
+        node->left = left;
+        node->right = right;
+        node->size = left->size + right->size;
+        node->height = std::max(left->height, right->height) + 1;
+        return node;
+    }
+
+    // Builds a branch from two subtrees whose heights differ by
+    // at most two, rotating to restore the AVL invariant.
+    static NodePtr balance(const NodePtr &left, const NodePtr &right) {
+        const size_t left_height = height(left);
+        const size_t right_height = height(right);
+        if (left_height > right_height + 1) {
+            if (height(left->left) >= height(left->right))
+                return make_branch(left->left, make_branch(left->right, right));
+            auto &middle = left->right;
+            return make_branch(make_branch(left->left, middle->left), make_branch(middle->right, right));
+        }
+        if (right_height > left_height + 1) {
+            if (height(right->right) >= height(right->left))
+                return make_branch(make_branch(left, right->left), right->right);
+            auto &middle = right->left;
+            return make_branch(make_branch(left, middle->left), make_branch(middle->right, right->right));
+        }
+        return make_branch(left, right);
+    }
+
+    static NodePtr join(const NodePtr &left, const NodePtr &right) {
+        if (!left) return right;
+        if (!right) return left;
+        if (left->is_leaf() && right->is_leaf() && left->size + right->size <= LEAF_MERGE_LIMIT) {
+            const size_t size = left->size + right->size;
+            auto buf = new char[size + 1];
+            memcpy(buf, left->data(), left->size);
+            memcpy(buf + left->size, right->data(), right->size);
+            buf[size] = '\0';
+            return make_leaf(String::create_and_take_ownership(buf, size), 0, size);
+        }
+        const size_t left_height = height(left);
+        const size_t right_height = height(right);
+        if (left_height > right_height + 1)
+            return balance(left->left, join(left->right, right));
+        if (right_height > left_height + 1)
+            return balance(join(left, right->left), right->right);
+        return make_branch(left, right);
+    }
+
+    static NodePtr slice(const NodePtr &node, size_t start, size_t length) {
+        if (length == 0)
+            return {};
+        if (start == 0 && length == node->size)
+            return node;
+        if (node->is_leaf())
+            return make_leaf(node->str, node->offset + start, length);
+        const size_t left_size = node->left->size;
+        if (start + length <= left_size)
+            return slice(node->left, start, length);
+        if (start >= left_size)
+            return slice(node->right, start - left_size, length);
+        auto left = slice(node->left, start, left_size - start);
+        auto right = slice(node->right, 0, start + length - left_size);
+        return join(left, right);
+    }
+
+    NodePtr m_root {};
+};
+
+}
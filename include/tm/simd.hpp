@@ -0,0 +1,1837 @@
+#pragma once
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/types.h>
+#include <type_traits>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define TM_SIMD_X86 1
+#include <immintrin.h>
+#define TM_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace TM {
+
+struct SIMD {
+    enum class Level {
+        Scalar,
+        SSE2,
+        AVX2,
+    };
+
+    // Largest set remove_any() matches with vector compares.
+    static constexpr size_t MAX_SIMD_SET_SIZE = 16;
+
+    /**
+     * Returns the instruction set the kernels dispatch to.
+     * This is the best one supported by the running CPU,
+     * unless lowered with set_level().
+     *
+     * ```
+     * assert(SIMD::level() <= SIMD::supported_level());
+     * ```
+     */
+    static Level level() { return current_level(); }
+
+    /**
+     * Returns the best instruction set supported by the running CPU.
+     *
+     * ```
+     * auto level = SIMD::supported_level();
+     * assert(level == SIMD::Level::Scalar || level == SIMD::Level::SSE2 || level == SIMD::Level::AVX2);
+     * ```
+     */
+    static Level supported_level() {
+        static const Level supported = detect_level();
+        return supported;
+    }
+
+    /**
+     * Changes the instruction set the kernels dispatch to.
+     * The level cannot be raised above what the CPU supports.
+     * This is mostly useful for testing every code path.
+     *
+     * ```
+     * SIMD::set_level(SIMD::Level::Scalar);
+     * assert(SIMD::level() == SIMD::Level::Scalar);
+     * SIMD::set_level(SIMD::Level::AVX2);
+     * assert(SIMD::level() == SIMD::supported_level());
+     * ```
+     */
+    static void set_level(Level level) {
+        current_level() = level <= supported_level() ? level : supported_level();
+    }
+
+    /**
+     * Returns true if searches over the given element type can use
+     * the vectorized kernels: integral, enum, pointer and floating-point
+     * types that are 1, 2, 4 or 8 bytes wide.
+     *
+     * ```
+     * static_assert(SIMD::is_vectorizable<uint32_t>());
+     * static_assert(SIMD::is_vectorizable<void *>());
+     * static_assert(SIMD::is_vectorizable<double>());
+     * static_assert(!SIMD::is_vectorizable<Thing>());
+     * ```
+     */
+    template <typename T>
+    static constexpr bool is_vectorizable() {
+        constexpr bool scalar_type = std::is_integral_v<T> || std::is_enum_v<T> || std::is_pointer_v<T> || std::is_floating_point_v<T>;
+        constexpr bool supported_size = sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8;
+        return scalar_type && supported_size;
+    }
+
+    /**
+     * Returns the index of the first item equal to the given value,
+     * or -1 if it is not found.
+     *
+     * ```
+     * for (auto level : { SIMD::Level::Scalar, SIMD::Level::SSE2, SIMD::Level::AVX2 }) {
+     *     SIMD::set_level(level);
+     *     uint32_t data[100];
+     *     for (uint32_t i = 0; i < 100; i++)
+     *         data[i] = i * 3;
+     *     for (uint32_t i = 0; i < 100; i++)
+     *         assert_eq((ssize_t)i, SIMD::find(data, 100, i * 3));
+     *     assert_eq(-1, SIMD::find(data, 100, 1u));
+     *     assert_eq(-1, SIMD::find(data, 0, 0u));
+     * }
+     * ```
+     *
+     * Every element width is supported, as are pointers and floats.
+     * Floats are compared with ==, so NaN is never found.
+     *
+     * ```
+     * for (auto level : { SIMD::Level::Scalar, SIMD::Level::SSE2, SIMD::Level::AVX2 }) {
+     *     SIMD::set_level(level);
+     *     char bytes[70] = {};
+     *     bytes[65] = 'x';
+     *     assert_eq(65, SIMD::find(bytes, 70, 'x'));
+     *     int16_t shorts[20] = {};
+     *     shorts[19] = -1;
+     *     assert_eq(19, SIMD::find(shorts, 20, (int16_t)-1));
+     *     int64_t longs[9] = {};
+     *     longs[8] = (int64_t)1 << 40;
+     *     assert_eq(-1, SIMD::find(longs, 9, (int64_t)1));
+     *     assert_eq(8, SIMD::find(longs, 9, (int64_t)1 << 40));
+     *     void *pointers[10] = {};
+     *     pointers[7] = &pointers;
+     *     assert_eq(7, SIMD::find(pointers, 10, (void *)&pointers));
+     *     float floats[12] = {};
+     *     floats[10] = 1.5;
+     *     floats[11] = __builtin_nanf("");
+     *     assert_eq(10, SIMD::find(floats, 12, 1.5f));
+     *     assert_eq(-1, SIMD::find(floats, 12, __builtin_nanf("")));
+     *     double doubles[5] = { 1.0, 2.0, -0.0, 4.0, 5.0 };
+     *     assert_eq(2, SIMD::find(doubles, 5, 0.0));
+     * }
+     * ```
+     *
+     * Other types are compared one at a time with ==, which
+     * lets containers like Vector and Span forward to this
+     * (and to index_of_first_not, count, min and max) for
+     * every item type.
+     *
+     * ```
+     * Thing things[] = { Thing(1), Thing(2) };
+     * assert_eq(1, SIMD::find(things, 2, Thing(2)));
+     * assert_eq(-1, SIMD::find(things, 2, Thing(3)));
+     * assert_eq(1, SIMD::count(things, 2, Thing(1)));
+     * ```
+     */
+    template <typename T>
+    static ssize_t find(const T *data, size_t size, const T &value) {
+        const size_t index = find_index<true>(data, size, value);
+        return index < size ? (ssize_t)index : -1;
+    }
+
+    /**
+     * Returns the index of the first item *not* equal to the given value,
+     * or -1 if every item is equal to it.
+     *
+     * ```
+     * for (auto level : { SIMD::Level::Scalar, SIMD::Level::SSE2, SIMD::Level::AVX2 }) {
+     *     SIMD::set_level(level);
+     *     uint8_t data[100];
+     *     memset(data, 0, 100);
+     *     assert_eq(-1, SIMD::index_of_first_not(data, 100, (uint8_t)0));
+     *     data[42] = 1;
+     *     assert_eq(42, SIMD::index_of_first_not(data, 100, (uint8_t)0));
+     *     assert_eq(0, SIMD::index_of_first_not(data, 100, (uint8_t)1));
+     *     uint64_t longs[6] = { 7, 7, 7, 7, 7, 8 };
+     *     assert_eq(5, SIMD::index_of_first_not(longs, 6, (uint64_t)7));
+     * }
+     * ```
+     */
+    template <typename T>
+    static ssize_t index_of_first_not(const T *data, size_t size, const T &value) {
+        const size_t index = find_index<false>(data, size, value);
+        return index < size ? (ssize_t)index : -1;
+    }
+
+    /**
+     * Returns the number of items equal to the given value.
+     *
+     * ```
+     * for (auto level : { SIMD::Level::Scalar, SIMD::Level::SSE2, SIMD::Level::AVX2 }) {
+     *     SIMD::set_level(level);
+     *     int data[101];
+     *     for (int i = 0; i < 101; i++)
+     *         data[i] = i % 3;
+     *     assert_eq(34, SIMD::count(data, 101, 0));
+     *     assert_eq(34, SIMD::count(data, 101, 1));
+     *     assert_eq(33, SIMD::count(data, 101, 2));
+     *     assert_eq(0, SIMD::count(data, 101, 3));
+     *     double doubles[7] = { 1, 2, 1, 2, 1, 2, 1 };
+     *     assert_eq(4, SIMD::count(doubles, 7, 1.0));
+     *     char bytes[40];
+     *     memset(bytes, 'a', 40);
+     *     assert_eq(40, SIMD::count(bytes, 40, 'a'));
+     * }
+     * ```
+     */
+    template <typename T>
+    static size_t count(const T *data, size_t size, const T &value) {
+#ifdef TM_SIMD_X86
+        if constexpr (is_vectorizable<T>()) {
+            switch (level()) {
+            case Level::AVX2:
+                return count_avx2(data, size, value);
+            case Level::SSE2:
+                return count_sse2(data, size, value);
+            case Level::Scalar:
+                break;
+            }
+        }
+#endif
+        return count_scalar(data, size, value);
+    }
+
+    /**
+     * Returns the smallest item. The size must not be zero.
+     *
+     * Integers of up to 32 bits, floats and doubles are compared
+     * in vectors at both levels; 64-bit integers only with AVX2,
+     * since SSE2 has no 64-bit compare. Other types use <. The
+     * result is always the one the scalar loop would find: the
+     * first of equal items wins, so min({ 0.0, -0.0 }) is 0.0, and
+     * NaN is skipped unless it is the first item, which is then
+     * returned because nothing compares less than it.
+     *
+     * ```
+     * for (auto level : { SIMD::Level::Scalar, SIMD::Level::SSE2, SIMD::Level::AVX2 }) {
+     *     SIMD::set_level(level);
+     *     int32_t data[77];
+     *     for (int i = 0; i < 77; i++)
+     *         data[i] = (i * 37) % 77 - 20;
+     *     assert_eq(-20, SIMD::min(data, 77));
+     *     uint8_t bytes[50];
+     *     for (int i = 0; i < 50; i++)
+     *         bytes[i] = 200 - i;
+     *     assert_eq(151, SIMD::min(bytes, 50));
+     *     int8_t signed_bytes[40] = {};
+     *     signed_bytes[33] = -128;
+     *     assert_eq(-128, SIMD::min(signed_bytes, 40));
+     *     double doubles[3] = { 2.5, -1.5, 0 };
+     *     assert_eq(-1.5, SIMD::min(doubles, 3));
+     * }
+     * ```
+     *
+     * ```
+     * for (auto level : { SIMD::Level::Scalar, SIMD::Level::SSE2, SIMD::Level::AVX2 }) {
+     *     SIMD::set_level(level);
+     *     float floats[37];
+     *     for (int i = 0; i < 37; i++)
+     *         floats[i] = ((i * 11) % 37) * 0.5f - 3.0f;
+     *     assert_eq(-3.0f, SIMD::min(floats, 37));
+     *     floats[5] = __builtin_nanf("");
+     *     floats[36] = __builtin_nanf("");
+     *     assert_eq(-3.0f, SIMD::min(floats, 37));
+     *     floats[0] = __builtin_nanf("");
+     *     auto nan = SIMD::min(floats, 37);
+     *     assert(nan != nan);
+     *
+     *     double doubles[19];
+     *     for (int i = 0; i < 19; i++)
+     *         doubles[i] = i == 7 ? -0.0 : i + 1.0;
+     *     doubles[12] = 0.0;
+     *     assert(__builtin_signbit(SIMD::min(doubles, 19)));
+     *     doubles[3] = 0.0;
+     *     assert_not(__builtin_signbit(SIMD::min(doubles, 19)));
+     *     doubles[18] = -__builtin_inf();
+     *     assert_eq(-__builtin_inf(), SIMD::min(doubles, 19));
+     *
+     *     int64_t longs[11];
+     *     for (int i = 0; i < 11; i++)
+     *         longs[i] = ((int64_t)1 << 40) - i * ((int64_t)1 << 36);
+     *     assert_eq(((int64_t)1 << 40) - 10 * ((int64_t)1 << 36), SIMD::min(longs, 11));
+     *     uint64_t ulongs[9] = { 5, UINT64_MAX, 1ULL << 63, 7, 9, 3, 8, 2, 6 };
+     *     assert_eq(2, SIMD::min(ulongs, 9));
+     * }
+     * ```
+     *
+     * ```should_abort
+     * int data[1] = { 0 };
+     * SIMD::min(data, 0);
+     * ```
+     */
+    template <typename T>
+    static T min(const T *data, size_t size) {
+        return extreme<false>(data, size);
+    }
+
+    /**
+     * Returns the largest item. The size must not be zero.
+     *
+     * ```
+     * for (auto level : { SIMD::Level::Scalar, SIMD::Level::SSE2, SIMD::Level::AVX2 }) {
+     *     SIMD::set_level(level);
+     *     uint32_t data[77];
+     *     for (uint32_t i = 0; i < 77; i++)
+     *         data[i] = (i * 37) % 77 + 3000000000u;
+     *     assert_eq(3000000076u, SIMD::max(data, 77));
+     *     int16_t shorts[33];
+     *     for (int i = 0; i < 33; i++)
+     *         shorts[i] = -1000 + i;
+     *     assert_eq(-968, SIMD::max(shorts, 33));
+     *     int64_t longs[3] = { 1, (int64_t)1 << 50, -1 };
+     *     assert_eq((int64_t)1 << 50, SIMD::max(longs, 3));
+     * }
+     * ```
+     *
+     * See min() for which types are vectorized and how NaN and
+     * signed zeros are handled.
+     *
+     * ```
+     * for (auto level : { SIMD::Level::Scalar, SIMD::Level::SSE2, SIMD::Level::AVX2 }) {
+     *     SIMD::set_level(level);
+     *     float floats[41];
+     *     for (int i = 0; i < 41; i++)
+     *         floats[i] = -((i * 13) % 41) * 0.25f;
+     *     floats[9] = __builtin_nanf("");
+     *     assert_eq(0.0f, SIMD::max(floats, 41));
+     *     floats[40] = 1e30f;
+     *     assert_eq(1e30f, SIMD::max(floats, 41));
+     *
+     *     double doubles[10] = { -0.0, -1, -2, -3, 0.0, -5, -6, -7, -8, -9 };
+     *     assert(__builtin_signbit(SIMD::max(doubles, 10)));
+     *     doubles[2] = __builtin_nan("");
+     *     doubles[6] = 2.5;
+     *     assert_eq(2.5, SIMD::max(doubles, 10));
+     *
+     *     uint64_t ulongs[9] = { 5, 1ULL << 63, 7, UINT64_MAX - 1, 9, 3, 8, 2, 6 };
+     *     assert_eq(UINT64_MAX - 1, SIMD::max(ulongs, 9));
+     *     int64_t longs[6] = { INT64_MIN, -1, -7, -3, -9, -2 };
+     *     assert_eq(-1, SIMD::max(longs, 6));
+     * }
+     * ```
+     */
+    template <typename T>
+    static T max(const T *data, size_t size) {
+        return extreme<true>(data, size);
+    }
+
+    /**
+     * Returns the index of the first occurrence of the needle
+     * bytes in the haystack bytes, or -1 if there is none.
+     * An empty needle is never found.
+     *
+     * Candidate positions are found by comparing the first and
+     * last byte of the needle against 16 or 32 positions at once,
+     * and only those are checked with memcmp.
+     *
+     * ```
+     * for (auto level : { SIMD::Level::Scalar, SIMD::Level::SSE2, SIMD::Level::AVX2 }) {
+     *     SIMD::set_level(level);
+     *     const char *haystack = "the quick brown fox jumps over the lazy dog, then the quick brown fox rests";
+     *     const size_t size = strlen(haystack);
+     *     assert_eq(0, SIMD::find_substring(haystack, size, "the", 3));
+     *     assert_eq(16, SIMD::find_substring(haystack, size, "fox", 3));
+     *     assert_eq(70, SIMD::find_substring(haystack, size, "rests", 5));
+     *     assert_eq(4, SIMD::find_substring(haystack, size, "q", 1));
+     *     assert_eq(-1, SIMD::find_substring(haystack, size, "cat", 3));
+     *     assert_eq(-1, SIMD::find_substring(haystack, size, "", 0));
+     *     assert_eq(-1, SIMD::find_substring("ab", 2, "abc", 3));
+     *     assert_eq(1, SIMD::find_substring("a\0b\0c", 5, "\0b\0", 3));
+     * }
+     * ```
+     */
+    static ssize_t find_substring(const char *haystack, size_t haystack_size, const char *needle, size_t needle_size) {
+        if (needle_size == 0 || needle_size > haystack_size)
+            return -1;
+        if (needle_size == 1) {
+            auto found = memchr(haystack, needle[0], haystack_size);
+            return found ? static_cast<const char *>(found) - haystack : -1;
+        }
+#ifdef TM_SIMD_X86
+        switch (level()) {
+        case Level::AVX2:
+            return find_substring_avx2(haystack, haystack_size, needle, needle_size);
+        case Level::SSE2:
+            return find_substring_sse2(haystack, haystack_size, needle, needle_size);
+        case Level::Scalar:
+            break;
+        }
+#endif
+        return find_substring_scalar(haystack, haystack_size, needle, needle_size, 0);
+    }
+
+    /**
+     * Returns the index of the last occurrence of the needle
+     * bytes in the haystack bytes, or -1 if there is none.
+     * An empty needle is never found.
+     *
+     * ```
+     * for (auto level : { SIMD::Level::Scalar, SIMD::Level::SSE2, SIMD::Level::AVX2 }) {
+     *     SIMD::set_level(level);
+     *     const char *haystack = "the quick brown fox jumps over the lazy dog, then the quick brown fox rests";
+     *     const size_t size = strlen(haystack);
+     *     assert_eq(50, SIMD::rfind_substring(haystack, size, "the", 3));
+     *     assert_eq(66, SIMD::rfind_substring(haystack, size, "fox", 3));
+     *     assert_eq(31, SIMD::rfind_substring(haystack, size, "the lazy", 8));
+     *     assert_eq(0, SIMD::rfind_substring(haystack, 9, "the", 3));
+     *     assert_eq(74, SIMD::rfind_substring(haystack, size, "s", 1));
+     *     assert_eq(-1, SIMD::rfind_substring(haystack, size, "cat", 3));
+     *     assert_eq(-1, SIMD::rfind_substring(haystack, size, "", 0));
+     * }
+     * ```
+     */
+    static ssize_t rfind_substring(const char *haystack, size_t haystack_size, const char *needle, size_t needle_size) {
+        if (needle_size == 0 || needle_size > haystack_size)
+            return -1;
+#ifdef TM_SIMD_X86
+        switch (level()) {
+        case Level::AVX2:
+            return rfind_substring_avx2(haystack, haystack_size, needle, needle_size);
+        case Level::SSE2:
+            return rfind_substring_sse2(haystack, haystack_size, needle, needle_size);
+        case Level::Scalar:
+            break;
+        }
+#endif
+        return rfind_substring_scalar(haystack, needle, needle_size, haystack_size - needle_size + 1);
+    }
+
+    /**
+     * Returns true if every byte is 7-bit ASCII.
+     *
+     * ```
+     * for (auto level : { SIMD::Level::Scalar, SIMD::Level::SSE2, SIMD::Level::AVX2 }) {
+     *     SIMD::set_level(level);
+     *     auto ascii = String(100, 'a');
+     *     assert(SIMD::is_ascii(ascii.c_str(), ascii.size()));
+     *     assert(SIMD::is_ascii("", 0));
+     *     for (size_t i = 0; i < ascii.size(); i++) {
+     *         auto str = ascii;
+     *         str[i] = '\x80';
+     *         assert_not(SIMD::is_ascii(str.c_str(), str.size()));
+     *     }
+     * }
+     * ```
+     */
+    static bool is_ascii(const char *data, size_t size) {
+        size_t i = 0;
+#ifdef TM_SIMD_X86
+        switch (level()) {
+        case Level::AVX2:
+            i = ascii_prefix_avx2(data, size);
+            break;
+        case Level::SSE2:
+            i = ascii_prefix_sse2(data, size);
+            break;
+        case Level::Scalar:
+            break;
+        }
+#endif
+        return ascii_prefix_scalar(data + i, size - i) == size - i;
+    }
+
+    /**
+     * Returns true if the bytes are well-formed UTF-8: no
+     * truncated or overlong sequences, no stray continuation
+     * bytes, no surrogates and nothing above U+10FFFF.
+     *
+     * The AVX2 kernel classifies 32 bytes at a time with the
+     * lookup algorithm by Keiser and Lemire (as in simdutf).
+     * That algorithm is built on byte shuffles (pshufb), which
+     * SSE2 does not have, so the SSE2 level only skips ASCII in
+     * 16-byte blocks and checks each multibyte sequence with the
+     * scalar code. Text that is mostly non-ASCII therefore gets
+     * little from SSE2; only AVX2 validates it a block at a time.
+     *
+     * ```
+     * for (auto level : { SIMD::Level::Scalar, SIMD::Level::SSE2, SIMD::Level::AVX2 }) {
+     *     SIMD::set_level(level);
+     *     auto valid = [](const char *str) { return SIMD::is_valid_utf8(str, strlen(str)); };
+     *     assert(valid(""));
+     *     assert(valid("plain ascii text that is longer than one block of thirty-two bytes"));
+     *     assert(valid("h\xC3\xA9llo w\xC3\xB6rld \xE2\x98\xBA \xF0\x9F\x90\x84 \xEF\xBF\xBF \xF4\x8F\xBF\xBF and more ascii afterwards"));
+     *     assert_not(valid("\x80"));                 // stray continuation
+     *     assert_not(valid("\xC3"));                 // truncated
+     *     assert_not(valid("\xC3\x28"));             // missing continuation
+     *     assert_not(valid("\xC0\xAF"));             // overlong 2-byte
+     *     assert_not(valid("\xE0\x80\xAF"));         // overlong 3-byte
+     *     assert_not(valid("\xF0\x80\x80\xAF"));     // overlong 4-byte
+     *     assert_not(valid("\xED\xA0\x80"));         // surrogate
+     *     assert_not(valid("\xF4\x90\x80\x80"));     // above U+10FFFF
+     *     assert_not(valid("\xF8\x88\x80\x80\x80")); // 5-byte form
+     *     assert_not(valid("\xE2\x98\xBA\xBA"));     // too many continuations
+     *     assert_not(valid("0123456789012345678901234567890\xE2\x98")); // truncated at the very end
+     * }
+     * ```
+     */
+    static bool is_valid_utf8(const char *data, size_t size) {
+#ifdef TM_SIMD_X86
+        switch (level()) {
+        case Level::AVX2:
+            return is_valid_utf8_avx2(data, size);
+        case Level::SSE2:
+            return is_valid_utf8_scalar<ascii_prefix_sse2>(data, size);
+        case Level::Scalar:
+            break;
+        }
+#endif
+        return is_valid_utf8_scalar<ascii_prefix_scalar>(data, size);
+    }
+
+    /**
+     * Returns the number of code points in the given UTF-8
+     * bytes, by counting every byte that is not a continuation
+     * byte. The result is only meaningful for valid UTF-8.
+     *
+     * ```
+     * for (auto level : { SIMD::Level::Scalar, SIMD::Level::SSE2, SIMD::Level::AVX2 }) {
+     *     SIMD::set_level(level);
+     *     auto length = [](const char *str) { return SIMD::utf8_length(str, strlen(str)); };
+     *     assert_eq(0, length(""));
+     *     assert_eq(3, length("abc"));
+     *     assert_eq(4, length("ab\xE2\x98\xBA\xF0\x9F\x90\x84"));
+     *     auto str = String();
+     *     for (int i = 0; i < 50; i++)
+     *         str.append("\xC3\xA9x");
+     *     assert_eq(100, SIMD::utf8_length(str.c_str(), str.size()));
+     * }
+     * ```
+     */
+    static size_t utf8_length(const char *data, size_t size) {
+#ifdef TM_SIMD_X86
+        switch (level()) {
+        case Level::AVX2:
+            return utf8_length_avx2(data, size);
+        case Level::SSE2:
+            return utf8_length_sse2(data, size);
+        case Level::Scalar:
+            break;
+        }
+#endif
+        return utf8_length_scalar(data, size);
+    }
+
+    /**
+     * Converts ASCII letters to uppercase in place, leaving every
+     * other byte (including all bytes of multibyte UTF-8
+     * characters) untouched. The conversion is branchless and
+     * does not depend on the locale.
+     *
+     * ```
+     * for (auto level : { SIMD::Level::Scalar, SIMD::Level::SSE2, SIMD::Level::AVX2 }) {
+     *     SIMD::set_level(level);
+     *     char buf[] = "Hello, World! @[`{ caf\xC3\xA9 0123456789 the quick brown fox";
+     *     SIMD::ascii_uppercase(buf, strlen(buf));
+     *     assert_str_eq("HELLO, WORLD! @[`{ CAF\xC3\xA9 0123456789 THE QUICK BROWN FOX", String(buf));
+     * }
+     * ```
+     */
+    static void ascii_uppercase(char *data, size_t size) {
+        convert_ascii_case<true>(data, size);
+    }
+
+    /**
+     * Converts ASCII letters to lowercase in place, leaving every
+     * other byte untouched. See ascii_uppercase.
+     *
+     * ```
+     * for (auto level : { SIMD::Level::Scalar, SIMD::Level::SSE2, SIMD::Level::AVX2 }) {
+     *     SIMD::set_level(level);
+     *     char buf[] = "Hello, World! @[`{ CAF\xC3\x89 0123456789 THE QUICK BROWN FOX";
+     *     SIMD::ascii_lowercase(buf, strlen(buf));
+     *     assert_str_eq("hello, world! @[`{ caf\xC3\x89 0123456789 the quick brown fox", String(buf));
+     * }
+     * ```
+     */
+    static void ascii_lowercase(char *data, size_t size) {
+        convert_ascii_case<false>(data, size);
+    }
+
+    /**
+     * Returns the index of the first position where the two
+     * buffers differ when ASCII letters are compared without
+     * regard to case, or size if they match.
+     *
+     * ```
+     * for (auto level : { SIMD::Level::Scalar, SIMD::Level::SSE2, SIMD::Level::AVX2 }) {
+     *     SIMD::set_level(level);
+     *     const char *first = "Content-Type: text/html; charset=UTF-8";
+     *     const char *second = "content-type: TEXT/HTML; CHARSET=utf-8";
+     *     assert_eq(strlen(first), SIMD::ascii_case_mismatch(first, second, strlen(first)));
+     *     assert_eq(37, SIMD::ascii_case_mismatch(first, "content-type: TEXT/HTML; CHARSET=utf-16", strlen(first)));
+     *     assert_eq(0, SIMD::ascii_case_mismatch("@", "`", 1)); // not letters
+     *     assert_eq(0, SIMD::ascii_case_mismatch("[", "{", 1));
+     * }
+     * ```
+     */
+    static size_t ascii_case_mismatch(const char *a, const char *b, size_t size) {
+        size_t i = 0;
+#ifdef TM_SIMD_X86
+        switch (level()) {
+        case Level::AVX2:
+            i = ascii_case_mismatch_avx2(a, b, size);
+            break;
+        case Level::SSE2:
+            i = ascii_case_mismatch_sse2(a, b, size);
+            break;
+        case Level::Scalar:
+            break;
+        }
+#endif
+        for (; i < size; i++) {
+            if (ascii_lower(a[i]) != ascii_lower(b[i]))
+                return i;
+        }
+        return size;
+    }
+
+    /**
+     * Returns the index of the first ASCII whitespace byte
+     * (space, \t, \n, \v, \f or \r), or -1 if there is none.
+     *
+     * ```
+     * for (auto level : { SIMD::Level::Scalar, SIMD::Level::SSE2, SIMD::Level::AVX2 }) {
+     *     SIMD::set_level(level);
+     *     const char *text = "the_quick_brown_fox_jumps_over_the_lazy_dog\vand_more";
+     *     assert_eq(43, SIMD::find_ascii_whitespace(text, strlen(text)));
+     *     assert_eq(3, SIMD::find_ascii_whitespace("abc def", 7));
+     *     assert_eq(-1, SIMD::find_ascii_whitespace("abc\x08\x0E\x1F!", 7));
+     *     assert_eq(-1, SIMD::find_ascii_whitespace("", 0));
+     * }
+     * ```
+     */
+    static ssize_t find_ascii_whitespace(const char *data, size_t size) {
+        const size_t index = find_whitespace_index<true>(data, size);
+        return index < size ? (ssize_t)index : -1;
+    }
+
+    /**
+     * Returns the index of the first byte that is not ASCII
+     * whitespace, or -1 if every byte is whitespace.
+     *
+     * ```
+     * for (auto level : { SIMD::Level::Scalar, SIMD::Level::SSE2, SIMD::Level::AVX2 }) {
+     *     SIMD::set_level(level);
+     *     const char *text = " \t\n\v\f\r                                     \t\tx";
+     *     assert_eq(strlen(text) - 1, SIMD::index_of_first_not_ascii_whitespace(text, strlen(text)));
+     *     assert_eq(-1, SIMD::index_of_first_not_ascii_whitespace(text, strlen(text) - 1));
+     *     assert_eq(0, SIMD::index_of_first_not_ascii_whitespace("\x80 ", 2));
+     * }
+     * ```
+     */
+    static ssize_t index_of_first_not_ascii_whitespace(const char *data, size_t size) {
+        const size_t index = find_whitespace_index<false>(data, size);
+        return index < size ? (ssize_t)index : -1;
+    }
+
+    /**
+     * Returns the size of the data without its trailing ASCII
+     * whitespace, scanning backwards from the end.
+     *
+     * ```
+     * for (auto level : { SIMD::Level::Scalar, SIMD::Level::SSE2, SIMD::Level::AVX2 }) {
+     *     SIMD::set_level(level);
+     *     const char *text = "x \t\n\v\f\r                                     \t\t";
+     *     assert_eq(1, SIMD::size_without_trailing_ascii_whitespace(text, strlen(text)));
+     *     assert_eq(0, SIMD::size_without_trailing_ascii_whitespace(text + 1, strlen(text) - 1));
+     *     assert_eq(2, SIMD::size_without_trailing_ascii_whitespace(" \x80", 2));
+     * }
+     * ```
+     */
+    static size_t size_without_trailing_ascii_whitespace(const char *data, size_t size) {
+#ifdef TM_SIMD_X86
+        switch (level()) {
+        case Level::AVX2:
+            size = rstrip_whitespace_avx2(data, size);
+            break;
+        case Level::SSE2:
+            size = rstrip_whitespace_sse2(data, size);
+            break;
+        case Level::Scalar:
+            break;
+        }
+#endif
+        while (size > 0 && is_ascii_whitespace(data[size - 1]))
+            size--;
+        return size;
+    }
+
+    /**
+     * Removes every occurrence of the given byte in place, moving
+     * the remaining bytes down in a single pass. Returns the new
+     * size. Blocks without a match are moved whole.
+     *
+     * ```
+     * for (auto level : { SIMD::Level::Scalar, SIMD::Level::SSE2, SIMD::Level::AVX2 }) {
+     *     SIMD::set_level(level);
+     *     char buf[] = "a,b,,c,d,e,f,g,h,i,j,k,l,m,n,o,p,q,r,s,t,u,v,w,x,y,z,";
+     *     const size_t size = SIMD::remove(buf, strlen(buf), ',');
+     *     assert_str_eq("abcdefghijklmnopqrstuvwxyz", String(buf, size));
+     *     assert_eq(0, SIMD::remove(buf, 0, ','));
+     * }
+     * ```
+     */
+    static size_t remove(char *data, size_t size, char value) {
+        size_t write = 0;
+        size_t i = compact<Removal::Byte>(data, size, &value, 1, write);
+        for (; i < size; i++) {
+            if (data[i] != value)
+                data[write++] = data[i];
+        }
+        return write;
+    }
+
+    /**
+     * Removes every byte that appears in the given set, in place,
+     * and returns the new size. Sets of up to MAX_SIMD_SET_SIZE
+     * bytes are matched with vector compares; larger sets fall
+     * back to a lookup table.
+     *
+     * ```
+     * for (auto level : { SIMD::Level::Scalar, SIMD::Level::SSE2, SIMD::Level::AVX2 }) {
+     *     SIMD::set_level(level);
+     *     char buf[] = "(555) 123-4567 / (555) 765-4321, ext. 89";
+     *     size_t size = SIMD::remove_any(buf, strlen(buf), "() -/,", 6);
+     *     assert_str_eq("55512345675557654321ext.89", String(buf, size));
+     *     size = SIMD::remove_any(buf, size, "abcdefghijklmnopqrstuvwxyz.", 27);
+     *     assert_str_eq("5551234567555765432189", String(buf, size));
+     *     assert_eq(size, SIMD::remove_any(buf, size, "", 0));
+     * }
+     * ```
+     */
+    static size_t remove_any(char *data, size_t size, const char *set, size_t set_size) {
+        if (set_size == 0)
+            return size;
+        size_t write = 0;
+        size_t i = 0;
+        if (set_size <= MAX_SIMD_SET_SIZE)
+            i = compact<Removal::Set>(data, size, set, set_size, write);
+        bool in_set[256] = {};
+        for (size_t j = 0; j < set_size; j++)
+            in_set[(unsigned char)set[j]] = true;
+        for (; i < size; i++) {
+            if (!in_set[(unsigned char)data[i]])
+                data[write++] = data[i];
+        }
+        return write;
+    }
+
+    /**
+     * Collapses each run of the given byte into a single one, in
+     * place, and returns the new size.
+     *
+     * ```
+     * for (auto level : { SIMD::Level::Scalar, SIMD::Level::SSE2, SIMD::Level::AVX2 }) {
+     *     SIMD::set_level(level);
+     *     char buf[] = "  a  b                                c d   ";
+     *     const size_t size = SIMD::squeeze(buf, strlen(buf), ' ');
+     *     assert_str_eq(" a b c d ", String(buf, size));
+     * }
+     * ```
+     */
+    static size_t squeeze(char *data, size_t size, char value) {
+        size_t write = 0;
+        size_t i = compact<Removal::Run>(data, size, &value, 1, write);
+        for (; i < size; i++) {
+            // the last byte kept is the value exactly when the previous input byte was
+            if (data[i] != value || write == 0 || data[write - 1] != value)
+                data[write++] = data[i];
+        }
+        return write;
+    }
+
+private:
+    static Level &current_level() {
+        static Level level = supported_level();
+        return level;
+    }
+
+    static Level detect_level() {
+#ifdef TM_SIMD_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return Level::AVX2;
+        if (__builtin_cpu_supports("sse2"))
+            return Level::SSE2;
+#endif
+        return Level::Scalar;
+    }
+
+    template <typename T>
+    static auto to_bits(T value) {
+        using Bits = std::conditional_t<sizeof(T) == 1, uint8_t,
+            std::conditional_t<sizeof(T) == 2, uint16_t,
+                std::conditional_t<sizeof(T) == 4, uint32_t, uint64_t>>>;
+        Bits bits;
+        memcpy(&bits, &value, sizeof(T));
+        return bits;
+    }
+
+    // Returns the index of the first item that is equal (or not equal,
+    // when Equal is false) to the given value, or size if there is none.
+    template <bool Equal, typename T>
+    static size_t find_index(const T *data, size_t size, const T &value) {
+#ifdef TM_SIMD_X86
+        if constexpr (is_vectorizable<T>()) {
+            switch (level()) {
+            case Level::AVX2:
+                return find_avx2<Equal>(data, size, value);
+            case Level::SSE2:
+                return find_sse2<Equal>(data, size, value);
+            case Level::Scalar:
+                break;
+            }
+        }
+#endif
+        return find_scalar<Equal>(data, size, value);
+    }
+
+    template <bool Equal, typename T>
+    static size_t find_scalar(const T *data, size_t size, const T &value) {
+        for (size_t i = 0; i < size; i++) {
+            if ((data[i] == value) == Equal)
+                return i;
+        }
+        return size;
+    }
+
+    template <typename T>
+    static size_t count_scalar(const T *data, size_t size, const T &value) {
+        size_t count = 0;
+        for (size_t i = 0; i < size; i++)
+            count += data[i] == value;
+        return count;
+    }
+
+    // Searches candidate positions from `start` onward.
+    static ssize_t find_substring_scalar(const char *haystack, size_t haystack_size, const char *needle, size_t needle_size, size_t start) {
+        const char *const last_start = haystack + haystack_size - needle_size;
+        const char *position = haystack + start;
+        while (position <= last_start) {
+            auto found = static_cast<const char *>(memchr(position, needle[0], last_start - position + 1));
+            if (!found)
+                return -1;
+            if (memcmp(found + 1, needle + 1, needle_size - 1) == 0)
+                return found - haystack;
+            position = found + 1;
+        }
+        return -1;
+    }
+
+    // Searches candidate positions below `end` (exclusive), last one first.
+    static ssize_t rfind_substring_scalar(const char *haystack, const char *needle, size_t needle_size, size_t end) {
+        for (size_t i = end; i > 0; i--) {
+            if (haystack[i - 1] == needle[0] && memcmp(haystack + i, needle + 1, needle_size - 1) == 0)
+                return i - 1;
+        }
+        return -1;
+    }
+
+    // Returns the length of the leading run of ASCII bytes, checking 8 at a time.
+    static size_t ascii_prefix_scalar(const char *data, size_t size) {
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8) {
+            uint64_t word;
+            memcpy(&word, data + i, sizeof(word));
+            if (word & 0x8080808080808080ULL)
+                break;
+        }
+        while (i < size && (unsigned char)data[i] < 0x80)
+            i++;
+        return i;
+    }
+
+    // Returns the length of the well-formed multibyte sequence
+    // at the start of data, or 0 if it is malformed.
+    static size_t utf8_sequence_length(const unsigned char *data, size_t size) {
+        const unsigned char lead = data[0];
+        auto continuation = [&](size_t index, unsigned char min = 0x80, unsigned char max = 0xBF) {
+            return index < size && data[index] >= min && data[index] <= max;
+        };
+        if (lead >= 0xC2 && lead <= 0xDF)
+            return continuation(1) ? 2 : 0;
+        if (lead >= 0xE0 && lead <= 0xEF) {
+            const unsigned char min = lead == 0xE0 ? 0xA0 : 0x80; // overlong
+            const unsigned char max = lead == 0xED ? 0x9F : 0xBF; // surrogates
+            return continuation(1, min, max) && continuation(2) ? 3 : 0;
+        }
+        if (lead >= 0xF0 && lead <= 0xF4) {
+            const unsigned char min = lead == 0xF0 ? 0x90 : 0x80; // overlong
+            const unsigned char max = lead == 0xF4 ? 0x8F : 0xBF; // above U+10FFFF
+            return continuation(1, min, max) && continuation(2) && continuation(3) ? 4 : 0;
+        }
+        return 0;
+    }
+
+    template <size_t (*AsciiPrefix)(const char *, size_t)>
+    static bool is_valid_utf8_scalar(const char *data, size_t size) {
+        size_t i = 0;
+        while (i < size) {
+            i += AsciiPrefix(data + i, size - i);
+            if (i == size)
+                break;
+            const size_t length = utf8_sequence_length(reinterpret_cast<const unsigned char *>(data) + i, size - i);
+            if (length == 0)
+                return false;
+            i += length;
+        }
+        return true;
+    }
+
+    static size_t utf8_length_scalar(const char *data, size_t size) {
+        size_t count = 0;
+        for (size_t i = 0; i < size; i++)
+            count += ((unsigned char)data[i] & 0xC0) != 0x80;
+        return count;
+    }
+
+    static char ascii_lower(char c) {
+        return c ^ (((unsigned char)(c - 'A') < 26) << 5);
+    }
+
+    template <bool Upper>
+    static void convert_ascii_case(char *data, size_t size) {
+        size_t i = 0;
+#ifdef TM_SIMD_X86
+        switch (level()) {
+        case Level::AVX2:
+            i = convert_ascii_case_avx2<Upper>(data, size);
+            break;
+        case Level::SSE2:
+            i = convert_ascii_case_sse2<Upper>(data, size);
+            break;
+        case Level::Scalar:
+            break;
+        }
+#endif
+        constexpr char first = Upper ? 'a' : 'A';
+        for (; i < size; i++)
+            data[i] ^= ((unsigned char)(data[i] - first) < 26) << 5;
+    }
+
+    static bool is_ascii_whitespace(char c) {
+        return c == ' ' || (c >= '\t' && c <= '\r');
+    }
+
+    // Returns the index of the first byte that is (or is not, when
+    // Whitespace is false) ASCII whitespace, or size if there is none.
+    template <bool Whitespace>
+    static size_t find_whitespace_index(const char *data, size_t size) {
+        size_t i = 0;
+#ifdef TM_SIMD_X86
+        switch (level()) {
+        case Level::AVX2:
+            i = find_whitespace_avx2<Whitespace>(data, size);
+            break;
+        case Level::SSE2:
+            i = find_whitespace_sse2<Whitespace>(data, size);
+            break;
+        case Level::Scalar:
+            break;
+        }
+#endif
+        for (; i < size; i++) {
+            if (is_ascii_whitespace(data[i]) == Whitespace)
+                return i;
+        }
+        return size;
+    }
+
+    // Which bytes compact() drops: those equal to a byte, those in
+    // a set, or those repeating the previous byte when it is the
+    // given one.
+    enum class Removal {
+        Byte,
+        Set,
+        Run,
+    };
+
+    // Compacts the SIMD-sized prefix of the data in place. Returns
+    // how many bytes were read; write is set to how many were kept.
+    template <Removal Mode>
+    static size_t compact(char *data, size_t size, const char *set, size_t set_size, size_t &write) {
+#ifdef TM_SIMD_X86
+        switch (level()) {
+        case Level::AVX2:
+            return compact_avx2<Mode>(data, size, set, set_size, write);
+        case Level::SSE2:
+            return compact_sse2<Mode>(data, size, set, set_size, write);
+        case Level::Scalar:
+            break;
+        }
+#else
+        (void)data;
+        (void)size;
+        (void)set;
+        (void)set_size;
+#endif
+        write = 0;
+        return 0;
+    }
+
+    template <bool Max, typename T>
+    static T extreme(const T *data, size_t size) {
+        assert(size > 0);
+#ifdef TM_SIMD_X86
+        if constexpr (std::is_integral_v<T> && sizeof(T) <= 4) {
+            switch (level()) {
+            case Level::AVX2:
+                return extreme_avx2<Max>(data, size);
+            case Level::SSE2:
+                return extreme_sse2<Max>(data, size);
+            case Level::Scalar:
+                break;
+            }
+        } else if constexpr (std::is_integral_v<T> && sizeof(T) == 8) {
+            // SSE2 has no 64-bit compare (pcmpgtq is SSE4.2)
+            if (level() == Level::AVX2)
+                return extreme_avx2<Max>(data, size);
+        } else if constexpr (std::is_same_v<T, float> || std::is_same_v<T, double>) {
+            switch (level()) {
+            case Level::AVX2:
+                return extreme_float_avx2<Max>(data, size);
+            case Level::SSE2:
+                return extreme_float_sse2<Max>(data, size);
+            case Level::Scalar:
+                break;
+            }
+        }
+#endif
+        return extreme_scalar<Max>(data, size);
+    }
+
+    template <bool Max, typename T>
+    static T extreme_scalar(const T *data, size_t size) {
+        size_t index = 0;
+        for (size_t i = 1; i < size; i++) {
+            if (Max ? data[index] < data[i] : data[i] < data[index])
+                index = i;
+        }
+        return data[index];
+    }
+
+#ifdef TM_SIMD_X86
+    template <typename T>
+    static __m128i broadcast_sse2(T value) {
+        if constexpr (std::is_same_v<T, float>)
+            return _mm_castps_si128(_mm_set1_ps(value));
+        else if constexpr (std::is_same_v<T, double>)
+            return _mm_castpd_si128(_mm_set1_pd(value));
+        else if constexpr (sizeof(T) == 1)
+            return _mm_set1_epi8((char)to_bits(value));
+        else if constexpr (sizeof(T) == 2)
+            return _mm_set1_epi16((short)to_bits(value));
+        else if constexpr (sizeof(T) == 4)
+            return _mm_set1_epi32((int)to_bits(value));
+        else
+            return _mm_set1_epi64x((long long)to_bits(value));
+    }
+
+    // Compares 16 bytes of items against the needle and returns
+    // a bitmask with sizeof(T) bits set for every equal item.
+    template <typename T>
+    static unsigned int equal_mask_sse2(const T *data, __m128i needle) {
+        __m128i equal;
+        if constexpr (std::is_same_v<T, float>) {
+            equal = _mm_castps_si128(_mm_cmpeq_ps(_mm_loadu_ps(data), _mm_castsi128_ps(needle)));
+        } else if constexpr (std::is_same_v<T, double>) {
+            equal = _mm_castpd_si128(_mm_cmpeq_pd(_mm_loadu_pd(data), _mm_castsi128_pd(needle)));
+        } else {
+            const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data));
+            if constexpr (sizeof(T) == 1) {
+                equal = _mm_cmpeq_epi8(chunk, needle);
+            } else if constexpr (sizeof(T) == 2) {
+                equal = _mm_cmpeq_epi16(chunk, needle);
+            } else if constexpr (sizeof(T) == 4) {
+                equal = _mm_cmpeq_epi32(chunk, needle);
+            } else {
+                // SSE2 has no 64-bit compare: both 32-bit halves must match
+                const __m128i halves = _mm_cmpeq_epi32(chunk, needle);
+                equal = _mm_and_si128(halves, _mm_shuffle_epi32(halves, _MM_SHUFFLE(2, 3, 0, 1)));
+            }
+        }
+        return (unsigned int)_mm_movemask_epi8(equal);
+    }
+
+    template <bool Equal, typename T>
+    static size_t find_sse2(const T *data, size_t size, T value) {
+        constexpr size_t lanes = 16 / sizeof(T);
+        const __m128i needle = broadcast_sse2(value);
+        size_t i = 0;
+        for (; i + lanes <= size; i += lanes) {
+            unsigned int mask = equal_mask_sse2(data + i, needle);
+            if (!Equal)
+                mask ^= 0xFFFF;
+            if (mask)
+                return i + __builtin_ctz(mask) / sizeof(T);
+        }
+        return i + find_scalar<Equal>(data + i, size - i, value);
+    }
+
+    template <typename T>
+    static size_t count_sse2(const T *data, size_t size, T value) {
+        constexpr size_t lanes = 16 / sizeof(T);
+        const __m128i needle = broadcast_sse2(value);
+        size_t count = 0;
+        size_t i = 0;
+        for (; i + lanes <= size; i += lanes)
+            count += __builtin_popcount(equal_mask_sse2(data + i, needle));
+        return count / sizeof(T) + count_scalar(data + i, size - i, value);
+    }
+
+    template <typename T>
+    TM_TARGET_AVX2 static __m256i broadcast_avx2(T value) {
+        if constexpr (std::is_same_v<T, float>)
+            return _mm256_castps_si256(_mm256_set1_ps(value));
+        else if constexpr (std::is_same_v<T, double>)
+            return _mm256_castpd_si256(_mm256_set1_pd(value));
+        else if constexpr (sizeof(T) == 1)
+            return _mm256_set1_epi8((char)to_bits(value));
+        else if constexpr (sizeof(T) == 2)
+            return _mm256_set1_epi16((short)to_bits(value));
+        else if constexpr (sizeof(T) == 4)
+            return _mm256_set1_epi32((int)to_bits(value));
+        else
+            return _mm256_set1_epi64x((long long)to_bits(value));
+    }
+
+    // Compares 32 bytes of items against the needle and returns
+    // a bitmask with sizeof(T) bits set for every equal item.
+    template <typename T>
+    TM_TARGET_AVX2 static unsigned int equal_mask_avx2(const T *data, __m256i needle) {
+        __m256i equal;
+        if constexpr (std::is_same_v<T, float>) {
+            equal = _mm256_castps_si256(_mm256_cmp_ps(_mm256_loadu_ps(data), _mm256_castsi256_ps(needle), _CMP_EQ_OQ));
+        } else if constexpr (std::is_same_v<T, double>) {
+            equal = _mm256_castpd_si256(_mm256_cmp_pd(_mm256_loadu_pd(data), _mm256_castsi256_pd(needle), _CMP_EQ_OQ));
+        } else {
+            const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data));
+            if constexpr (sizeof(T) == 1)
+                equal = _mm256_cmpeq_epi8(chunk, needle);
+            else if constexpr (sizeof(T) == 2)
+                equal = _mm256_cmpeq_epi16(chunk, needle);
+            else if constexpr (sizeof(T) == 4)
+                equal = _mm256_cmpeq_epi32(chunk, needle);
+            else
+                equal = _mm256_cmpeq_epi64(chunk, needle);
+        }
+        return (unsigned int)_mm256_movemask_epi8(equal);
+    }
+
+    template <bool Equal, typename T>
+    TM_TARGET_AVX2 static size_t find_avx2(const T *data, size_t size, T value) {
+        constexpr size_t lanes = 32 / sizeof(T);
+        const __m256i needle = broadcast_avx2(value);
+        size_t i = 0;
+        for (; i + lanes <= size; i += lanes) {
+            unsigned int mask = equal_mask_avx2(data + i, needle);
+            if (!Equal)
+                mask = ~mask;
+            if (mask)
+                return i + __builtin_ctz(mask) / sizeof(T);
+        }
+        return i + find_scalar<Equal>(data + i, size - i, value);
+    }
+
+    template <typename T>
+    TM_TARGET_AVX2 static size_t count_avx2(const T *data, size_t size, T value) {
+        constexpr size_t lanes = 32 / sizeof(T);
+        const __m256i needle = broadcast_avx2(value);
+        size_t count = 0;
+        size_t i = 0;
+        for (; i + lanes <= size; i += lanes)
+            count += __builtin_popcount(equal_mask_avx2(data + i, needle));
+        return count / sizeof(T) + count_scalar(data + i, size - i, value);
+    }
+
+    // SSE2 only has min and max for unsigned bytes and signed
+    // shorts. Other widths compare and select, flipping the sign
+    // bit first so unsigned values compare correctly as signed.
+    template <bool Max, typename T>
+    static __m128i extreme_of_sse2(__m128i a, __m128i b) {
+        constexpr bool is_signed = std::is_signed_v<T>;
+        if constexpr (sizeof(T) == 1 && !is_signed) {
+            return Max ? _mm_max_epu8(a, b) : _mm_min_epu8(a, b);
+        } else if constexpr (sizeof(T) == 2 && is_signed) {
+            return Max ? _mm_max_epi16(a, b) : _mm_min_epi16(a, b);
+        } else {
+            __m128i a_signed = a;
+            __m128i b_signed = b;
+            if constexpr (!is_signed) {
+                const __m128i sign_bit = broadcast_sse2<T>((T)1 << (sizeof(T) * 8 - 1));
+                a_signed = _mm_xor_si128(a, sign_bit);
+                b_signed = _mm_xor_si128(b, sign_bit);
+            }
+            const __m128i take_a = Max ? greater_than_sse2<T>(a_signed, b_signed) : greater_than_sse2<T>(b_signed, a_signed);
+            return _mm_or_si128(_mm_and_si128(take_a, a), _mm_andnot_si128(take_a, b));
+        }
+    }
+
+    template <typename T>
+    static __m128i greater_than_sse2(__m128i a, __m128i b) {
+        if constexpr (sizeof(T) == 1)
+            return _mm_cmpgt_epi8(a, b);
+        else if constexpr (sizeof(T) == 2)
+            return _mm_cmpgt_epi16(a, b);
+        else
+            return _mm_cmpgt_epi32(a, b);
+    }
+
+    template <bool Max, typename T>
+    static T extreme_sse2(const T *data, size_t size) {
+        constexpr size_t lanes = 16 / sizeof(T);
+        if (size < lanes)
+            return extreme_scalar<Max>(data, size);
+        auto load = [data](size_t index) { return _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + index)); };
+        // four running results, so each step does not wait on the last
+        __m128i result0 = load(0), result1 = result0, result2 = result0, result3 = result0;
+        size_t i = lanes;
+        for (; i + 4 * lanes <= size; i += 4 * lanes) {
+            result0 = extreme_of_sse2<Max, T>(result0, load(i));
+            result1 = extreme_of_sse2<Max, T>(result1, load(i + lanes));
+            result2 = extreme_of_sse2<Max, T>(result2, load(i + 2 * lanes));
+            result3 = extreme_of_sse2<Max, T>(result3, load(i + 3 * lanes));
+        }
+        for (; i + lanes <= size; i += lanes)
+            result0 = extreme_of_sse2<Max, T>(result0, load(i));
+        const __m128i result = extreme_of_sse2<Max, T>(extreme_of_sse2<Max, T>(result0, result1), extreme_of_sse2<Max, T>(result2, result3));
+        T lane_values[lanes];
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(lane_values), result);
+        T extreme = extreme_scalar<Max>(lane_values, lanes);
+        if (i < size) {
+            const T tail = extreme_scalar<Max>(data + i, size - i);
+            if (Max ? extreme < tail : tail < extreme)
+                extreme = tail;
+        }
+        return extreme;
+    }
+
+    template <bool Max, typename T>
+    TM_TARGET_AVX2 static __m256i extreme_of_avx2(__m256i a, __m256i b) {
+        constexpr bool is_signed = std::is_signed_v<T>;
+        if constexpr (sizeof(T) == 1)
+            return Max ? (is_signed ? _mm256_max_epi8(a, b) : _mm256_max_epu8(a, b)) : (is_signed ? _mm256_min_epi8(a, b) : _mm256_min_epu8(a, b));
+        else if constexpr (sizeof(T) == 2)
+            return Max ? (is_signed ? _mm256_max_epi16(a, b) : _mm256_max_epu16(a, b)) : (is_signed ? _mm256_min_epi16(a, b) : _mm256_min_epu16(a, b));
+        else if constexpr (sizeof(T) == 4)
+            return Max ? (is_signed ? _mm256_max_epi32(a, b) : _mm256_max_epu32(a, b)) : (is_signed ? _mm256_min_epi32(a, b) : _mm256_min_epu32(a, b));
+        else {
+            // there is no 64-bit min or max, so compare and blend
+            __m256i a_signed = a;
+            __m256i b_signed = b;
+            if constexpr (!is_signed) {
+                const __m256i sign_bit = _mm256_set1_epi64x(INT64_MIN);
+                a_signed = _mm256_xor_si256(a, sign_bit);
+                b_signed = _mm256_xor_si256(b, sign_bit);
+            }
+            const __m256i take_a = Max ? _mm256_cmpgt_epi64(a_signed, b_signed) : _mm256_cmpgt_epi64(b_signed, a_signed);
+            return _mm256_blendv_epi8(b, a, take_a);
+        }
+    }
+
+    template <bool Max, typename T>
+    TM_TARGET_AVX2 static T extreme_avx2(const T *data, size_t size) {
+        constexpr size_t lanes = 32 / sizeof(T);
+        if (size < lanes)
+            return extreme_scalar<Max>(data, size);
+        auto load = [data](size_t index) TM_TARGET_AVX2 { return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + index)); };
+        __m256i result0 = load(0), result1 = result0, result2 = result0, result3 = result0;
+        size_t i = lanes;
+        for (; i + 4 * lanes <= size; i += 4 * lanes) {
+            result0 = extreme_of_avx2<Max, T>(result0, load(i));
+            result1 = extreme_of_avx2<Max, T>(result1, load(i + lanes));
+            result2 = extreme_of_avx2<Max, T>(result2, load(i + 2 * lanes));
+            result3 = extreme_of_avx2<Max, T>(result3, load(i + 3 * lanes));
+        }
+        for (; i + lanes <= size; i += lanes)
+            result0 = extreme_of_avx2<Max, T>(result0, load(i));
+        const __m256i result = extreme_of_avx2<Max, T>(extreme_of_avx2<Max, T>(result0, result1), extreme_of_avx2<Max, T>(result2, result3));
+        T lane_values[lanes];
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(lane_values), result);
+        T extreme = extreme_scalar<Max>(lane_values, lanes);
+        if (i < size) {
+            const T tail = extreme_scalar<Max>(data + i, size - i);
+            if (Max ? extreme < tail : tail < extreme)
+                extreme = tail;
+        }
+        return extreme;
+    }
+
+    // Float min and max return their second operand when either one
+    // is NaN, so keeping the running result second skips NaN items
+    // the way the scalar loop does. The result starts out as the
+    // first item, which is returned as is when it is NaN.
+    template <bool Max, typename T>
+    static __m128i float_extreme_of_sse2(__m128i items, __m128i result) {
+        if constexpr (std::is_same_v<T, float>) {
+            const __m128 a = _mm_castsi128_ps(items), b = _mm_castsi128_ps(result);
+            return _mm_castps_si128(Max ? _mm_max_ps(a, b) : _mm_min_ps(a, b));
+        } else {
+            const __m128d a = _mm_castsi128_pd(items), b = _mm_castsi128_pd(result);
+            return _mm_castpd_si128(Max ? _mm_max_pd(a, b) : _mm_min_pd(a, b));
+        }
+    }
+
+    template <bool Max, typename T>
+    static T extreme_float_sse2(const T *data, size_t size) {
+        constexpr size_t lanes = 16 / sizeof(T);
+        if (size < lanes || data[0] != data[0])
+            return extreme_scalar<Max>(data, size);
+        auto load = [data](size_t index) { return _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + index)); };
+        // four running results, so each step does not wait on the last
+        __m128i result0 = broadcast_sse2(data[0]), result1 = result0, result2 = result0, result3 = result0;
+        size_t i = 0;
+        for (; i + 4 * lanes <= size; i += 4 * lanes) {
+            result0 = float_extreme_of_sse2<Max, T>(load(i), result0);
+            result1 = float_extreme_of_sse2<Max, T>(load(i + lanes), result1);
+            result2 = float_extreme_of_sse2<Max, T>(load(i + 2 * lanes), result2);
+            result3 = float_extreme_of_sse2<Max, T>(load(i + 3 * lanes), result3);
+        }
+        for (; i + lanes <= size; i += lanes)
+            result0 = float_extreme_of_sse2<Max, T>(load(i), result0);
+        const __m128i result = float_extreme_of_sse2<Max, T>(
+            float_extreme_of_sse2<Max, T>(result0, result1),
+            float_extreme_of_sse2<Max, T>(result2, result3));
+        T lane_values[lanes];
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(lane_values), result);
+        return finish_float_extreme<Max>(data, data + i, size - i, extreme_scalar<Max>(lane_values, lanes));
+    }
+
+    template <bool Max, typename T>
+    TM_TARGET_AVX2 static __m256i float_extreme_of_avx2(__m256i items, __m256i result) {
+        if constexpr (std::is_same_v<T, float>) {
+            const __m256 a = _mm256_castsi256_ps(items), b = _mm256_castsi256_ps(result);
+            return _mm256_castps_si256(Max ? _mm256_max_ps(a, b) : _mm256_min_ps(a, b));
+        } else {
+            const __m256d a = _mm256_castsi256_pd(items), b = _mm256_castsi256_pd(result);
+            return _mm256_castpd_si256(Max ? _mm256_max_pd(a, b) : _mm256_min_pd(a, b));
+        }
+    }
+
+    template <bool Max, typename T>
+    TM_TARGET_AVX2 static T extreme_float_avx2(const T *data, size_t size) {
+        constexpr size_t lanes = 32 / sizeof(T);
+        if (size < lanes || data[0] != data[0])
+            return extreme_scalar<Max>(data, size);
+        auto load = [data](size_t index) TM_TARGET_AVX2 { return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + index)); };
+        __m256i result0 = broadcast_avx2(data[0]), result1 = result0, result2 = result0, result3 = result0;
+        size_t i = 0;
+        for (; i + 4 * lanes <= size; i += 4 * lanes) {
+            result0 = float_extreme_of_avx2<Max, T>(load(i), result0);
+            result1 = float_extreme_of_avx2<Max, T>(load(i + lanes), result1);
+            result2 = float_extreme_of_avx2<Max, T>(load(i + 2 * lanes), result2);
+            result3 = float_extreme_of_avx2<Max, T>(load(i + 3 * lanes), result3);
+        }
+        for (; i + lanes <= size; i += lanes)
+            result0 = float_extreme_of_avx2<Max, T>(load(i), result0);
+        const __m256i result = float_extreme_of_avx2<Max, T>(
+            float_extreme_of_avx2<Max, T>(result0, result1),
+            float_extreme_of_avx2<Max, T>(result2, result3));
+        T lane_values[lanes];
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(lane_values), result);
+        return finish_float_extreme<Max>(data, data + i, size - i, extreme_scalar<Max>(lane_values, lanes));
+    }
+
+    // Folds the items past the last full vector into the extreme of the
+    // lanes. Which of 0.0 and -0.0 comes out of the lanes depends on the
+    // order of the items, so for a zero, return the first one instead,
+    // as the scalar loop would.
+    template <bool Max, typename T>
+    static T finish_float_extreme(const T *data, const T *tail, size_t tail_size, T extreme) {
+        for (size_t i = 0; i < tail_size; i++) {
+            if (Max ? extreme < tail[i] : tail[i] < extreme)
+                extreme = tail[i];
+        }
+        if (extreme == 0) {
+            while (*data != 0)
+                data++;
+            return *data;
+        }
+        return extreme;
+    }
+
+    // Returns a bitmask of the 16 positions starting at `position`
+    // where both the first and last byte of the needle match.
+    static unsigned int candidate_mask_sse2(const char *position, size_t needle_size, __m128i first, __m128i last) {
+        const __m128i first_block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(position));
+        const __m128i last_block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(position + needle_size - 1));
+        const __m128i matches = _mm_and_si128(_mm_cmpeq_epi8(first_block, first), _mm_cmpeq_epi8(last_block, last));
+        return (unsigned int)_mm_movemask_epi8(matches);
+    }
+
+    static ssize_t find_substring_sse2(const char *haystack, size_t haystack_size, const char *needle, size_t needle_size) {
+        const __m128i first = _mm_set1_epi8(needle[0]);
+        const __m128i last = _mm_set1_epi8(needle[needle_size - 1]);
+        size_t i = 0;
+        for (; i + needle_size - 1 + 16 <= haystack_size; i += 16) {
+            unsigned int mask = candidate_mask_sse2(haystack + i, needle_size, first, last);
+            while (mask) {
+                const size_t index = i + __builtin_ctz(mask);
+                if (memcmp(haystack + index + 1, needle + 1, needle_size - 2) == 0)
+                    return index;
+                mask &= mask - 1;
+            }
+        }
+        return find_substring_scalar(haystack, haystack_size, needle, needle_size, i);
+    }
+
+    static ssize_t rfind_substring_sse2(const char *haystack, size_t haystack_size, const char *needle, size_t needle_size) {
+        const __m128i first = _mm_set1_epi8(needle[0]);
+        const __m128i last = _mm_set1_epi8(needle[needle_size - 1]);
+        size_t end = haystack_size - needle_size + 1; // one past the last candidate position
+        for (; end >= 16; end -= 16) {
+            const size_t i = end - 16;
+            unsigned int mask = candidate_mask_sse2(haystack + i, needle_size, first, last);
+            while (mask) {
+                const size_t bit = 31 - __builtin_clz(mask);
+                if (memcmp(haystack + i + bit, needle, needle_size) == 0)
+                    return i + bit;
+                mask &= ~(1u << bit);
+            }
+        }
+        return rfind_substring_scalar(haystack, needle, needle_size, end);
+    }
+
+    TM_TARGET_AVX2 static unsigned int candidate_mask_avx2(const char *position, size_t needle_size, __m256i first, __m256i last) {
+        const __m256i first_block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(position));
+        const __m256i last_block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(position + needle_size - 1));
+        const __m256i matches = _mm256_and_si256(_mm256_cmpeq_epi8(first_block, first), _mm256_cmpeq_epi8(last_block, last));
+        return (unsigned int)_mm256_movemask_epi8(matches);
+    }
+
+    TM_TARGET_AVX2 static ssize_t find_substring_avx2(const char *haystack, size_t haystack_size, const char *needle, size_t needle_size) {
+        const __m256i first = _mm256_set1_epi8(needle[0]);
+        const __m256i last = _mm256_set1_epi8(needle[needle_size - 1]);
+        size_t i = 0;
+        for (; i + needle_size - 1 + 32 <= haystack_size; i += 32) {
+            unsigned int mask = candidate_mask_avx2(haystack + i, needle_size, first, last);
+            while (mask) {
+                const size_t index = i + __builtin_ctz(mask);
+                if (memcmp(haystack + index + 1, needle + 1, needle_size - 2) == 0)
+                    return index;
+                mask &= mask - 1;
+            }
+        }
+        return find_substring_scalar(haystack, haystack_size, needle, needle_size, i);
+    }
+
+    TM_TARGET_AVX2 static ssize_t rfind_substring_avx2(const char *haystack, size_t haystack_size, const char *needle, size_t needle_size) {
+        const __m256i first = _mm256_set1_epi8(needle[0]);
+        const __m256i last = _mm256_set1_epi8(needle[needle_size - 1]);
+        size_t end = haystack_size - needle_size + 1; // one past the last candidate position
+        for (; end >= 32; end -= 32) {
+            const size_t i = end - 32;
+            unsigned int mask = candidate_mask_avx2(haystack + i, needle_size, first, last);
+            while (mask) {
+                const size_t bit = 31 - __builtin_clz(mask);
+                if (memcmp(haystack + i + bit, needle, needle_size) == 0)
+                    return i + bit;
+                mask &= ~(1u << bit);
+            }
+        }
+        return rfind_substring_scalar(haystack, needle, needle_size, end);
+    }
+
+    static size_t ascii_prefix_sse2(const char *data, size_t size) {
+        size_t i = 0;
+        for (; i + 16 <= size; i += 16) {
+            const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+            if (_mm_movemask_epi8(block))
+                break;
+        }
+        return i + ascii_prefix_scalar(data + i, size - i);
+    }
+
+    // Continuation bytes are 0x80-0xBF, i.e. -128 to -65 as signed bytes.
+    static size_t utf8_length_sse2(const char *data, size_t size) {
+        const __m128i last_continuation = _mm_set1_epi8(-65);
+        size_t count = 0;
+        size_t i = 0;
+        for (; i + 16 <= size; i += 16) {
+            const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+            count += __builtin_popcount(_mm_movemask_epi8(_mm_cmpgt_epi8(block, last_continuation)));
+        }
+        return count + utf8_length_scalar(data + i, size - i);
+    }
+
+    TM_TARGET_AVX2 static size_t ascii_prefix_avx2(const char *data, size_t size) {
+        size_t i = 0;
+        for (; i + 32 <= size; i += 32) {
+            const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+            if (_mm256_movemask_epi8(block))
+                break;
+        }
+        return i + ascii_prefix_scalar(data + i, size - i);
+    }
+
+    TM_TARGET_AVX2 static size_t utf8_length_avx2(const char *data, size_t size) {
+        const __m256i last_continuation = _mm256_set1_epi8(-65);
+        size_t count = 0;
+        size_t i = 0;
+        for (; i + 32 <= size; i += 32) {
+            const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+            count += __builtin_popcount(_mm256_movemask_epi8(_mm256_cmpgt_epi8(block, last_continuation)));
+        }
+        return count + utf8_length_scalar(data + i, size - i);
+    }
+
+    // Returns the input shifted by N bytes, with the last N bytes of
+    // the previous block shifted in.
+    template <int N>
+    TM_TARGET_AVX2 static __m256i previous_bytes_avx2(__m256i input, __m256i previous) {
+        return _mm256_alignr_epi8(input, _mm256_permute2x128_si256(previous, input, 0x21), 16 - N);
+    }
+
+    TM_TARGET_AVX2 static __m256i high_nibbles_avx2(__m256i bytes) {
+        return _mm256_and_si256(_mm256_srli_epi16(bytes, 4), _mm256_set1_epi8(0x0F));
+    }
+
+    // Classifies each pair of adjacent bytes by looking up the high and low
+    // nibble of the first byte and the high nibble of the second; any bit
+    // set in all three lookups is an error (or, for TWO_CONTINUATIONS, a
+    // continuation that must be accounted for by a 3 or 4-byte lead).
+    TM_TARGET_AVX2 static __m256i utf8_special_cases_avx2(__m256i input, __m256i previous1) {
+        constexpr char TOO_SHORT = 1 << 0; // 11______ 0_______ or 11______ 11______
+        constexpr char TOO_LONG = 1 << 1; // 0_______ 10______
+        constexpr char OVERLONG_3 = 1 << 2; // 11100000 100_____
+        constexpr char TOO_LARGE = 1 << 3; // 11110100 1001____ and above
+        constexpr char SURROGATE = 1 << 4; // 11101101 101_____
+        constexpr char OVERLONG_2 = 1 << 5; // 1100000_ 10______
+        constexpr char TOO_LARGE_1000 = 1 << 6; // 11110101 1000____ and above
+        constexpr char OVERLONG_4 = 1 << 6; // 11110000 1000____
+        constexpr char TWO_CONTINUATIONS = (char)(1 << 7); // 10______ 10______
+        constexpr char CARRY = TOO_SHORT | TOO_LONG | TWO_CONTINUATIONS;
+
+        const __m256i byte_1_high_table = _mm256_setr_epi8(
+            TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+            TWO_CONTINUATIONS, TWO_CONTINUATIONS, TWO_CONTINUATIONS, TWO_CONTINUATIONS,
+            TOO_SHORT | OVERLONG_2,
+            TOO_SHORT,
+            TOO_SHORT | OVERLONG_3 | SURROGATE,
+            TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4,
+            TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+            TWO_CONTINUATIONS, TWO_CONTINUATIONS, TWO_CONTINUATIONS, TWO_CONTINUATIONS,
+            TOO_SHORT | OVERLONG_2,
+            TOO_SHORT,
+            TOO_SHORT | OVERLONG_3 | SURROGATE,
+            TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4);
+        const __m256i byte_1_low_table = _mm256_setr_epi8(
+            CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+            CARRY | OVERLONG_2,
+            CARRY,
+            CARRY,
+            CARRY | TOO_LARGE,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+            CARRY | OVERLONG_2,
+            CARRY,
+            CARRY,
+            CARRY | TOO_LARGE,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000);
+        const __m256i byte_2_high_table = _mm256_setr_epi8(
+            TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+            TOO_LONG | OVERLONG_2 | TWO_CONTINUATIONS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,
+            TOO_LONG | OVERLONG_2 | TWO_CONTINUATIONS | OVERLONG_3 | TOO_LARGE,
+            TOO_LONG | OVERLONG_2 | TWO_CONTINUATIONS | SURROGATE | TOO_LARGE,
+            TOO_LONG | OVERLONG_2 | TWO_CONTINUATIONS | SURROGATE | TOO_LARGE,
+            TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+            TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+            TOO_LONG | OVERLONG_2 | TWO_CONTINUATIONS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,
+            TOO_LONG | OVERLONG_2 | TWO_CONTINUATIONS | OVERLONG_3 | TOO_LARGE,
+            TOO_LONG | OVERLONG_2 | TWO_CONTINUATIONS | SURROGATE | TOO_LARGE,
+            TOO_LONG | OVERLONG_2 | TWO_CONTINUATIONS | SURROGATE | TOO_LARGE,
+            TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT);
+
+        const __m256i byte_1_high = _mm256_shuffle_epi8(byte_1_high_table, high_nibbles_avx2(previous1));
+        const __m256i byte_1_low = _mm256_shuffle_epi8(byte_1_low_table, _mm256_and_si256(previous1, _mm256_set1_epi8(0x0F)));
+        const __m256i byte_2_high = _mm256_shuffle_epi8(byte_2_high_table, high_nibbles_avx2(input));
+        return _mm256_and_si256(_mm256_and_si256(byte_1_high, byte_1_low), byte_2_high);
+    }
+
+    TM_TARGET_AVX2 static __m256i utf8_block_errors_avx2(__m256i input, __m256i previous) {
+        const __m256i previous1 = previous_bytes_avx2<1>(input, previous);
+        const __m256i special_cases = utf8_special_cases_avx2(input, previous1);
+        // A byte two (three) positions after a 3-byte (4-byte) lead must be a
+        // continuation; those are exactly the TWO_CONTINUATIONS bits above.
+        const __m256i previous2 = previous_bytes_avx2<2>(input, previous);
+        const __m256i previous3 = previous_bytes_avx2<3>(input, previous);
+        const __m256i is_third_byte = _mm256_subs_epu8(previous2, _mm256_set1_epi8((char)(0xE0 - 0x80)));
+        const __m256i is_fourth_byte = _mm256_subs_epu8(previous3, _mm256_set1_epi8((char)(0xF0 - 0x80)));
+        const __m256i must_be_continuation = _mm256_and_si256(_mm256_or_si256(is_third_byte, is_fourth_byte), _mm256_set1_epi8((char)0x80));
+        return _mm256_xor_si256(must_be_continuation, special_cases);
+    }
+
+    // Flags a block whose last bytes start a sequence that must continue
+    // into the next block.
+    TM_TARGET_AVX2 static __m256i utf8_incomplete_avx2(__m256i input) {
+        const __m256i max_complete = _mm256_setr_epi8(
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            (char)(0xF0 - 1), (char)(0xE0 - 1), (char)(0xC0 - 1));
+        return _mm256_subs_epu8(input, max_complete);
+    }
+
+    TM_TARGET_AVX2 static bool is_valid_utf8_avx2(const char *data, size_t size) {
+        __m256i error = _mm256_setzero_si256();
+        __m256i previous = _mm256_setzero_si256();
+        __m256i previous_incomplete = _mm256_setzero_si256();
+        auto check_block = [&](__m256i input) __attribute__((target("avx2"))) {
+            if (_mm256_movemask_epi8(input) == 0) {
+                // all ASCII: only a sequence left open by the previous block is an error
+                error = _mm256_or_si256(error, previous_incomplete);
+            } else {
+                error = _mm256_or_si256(error, utf8_block_errors_avx2(input, previous));
+                previous_incomplete = utf8_incomplete_avx2(input);
+            }
+            previous = input;
+        };
+        size_t i = 0;
+        for (; i + 32 <= size; i += 32)
+            check_block(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i)));
+        if (i < size) {
+            // pad the tail with zeros, which are ASCII
+            char tail[32] = { 0 };
+            memcpy(tail, data + i, size - i);
+            check_block(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(tail)));
+        }
+        error = _mm256_or_si256(error, previous_incomplete);
+        return _mm256_testz_si256(error, error);
+    }
+
+    // Flips the case bit (0x20) of every byte in [first, first + 26).
+    // SSE2 has no unsigned byte compare, so the range is shifted down
+    // to start at -128 and tested with a signed compare.
+    static __m128i flip_case_sse2(__m128i block, char first) {
+        const __m128i shifted = _mm_sub_epi8(block, _mm_set1_epi8((char)(first + 128)));
+        const __m128i in_range = _mm_cmplt_epi8(shifted, _mm_set1_epi8(-128 + 26));
+        return _mm_xor_si128(block, _mm_and_si128(in_range, _mm_set1_epi8(0x20)));
+    }
+
+    template <bool Upper>
+    static size_t convert_ascii_case_sse2(char *data, size_t size) {
+        size_t i = 0;
+        for (; i + 16 <= size; i += 16) {
+            auto position = reinterpret_cast<__m128i *>(data + i);
+            _mm_storeu_si128(position, flip_case_sse2(_mm_loadu_si128(position), Upper ? 'a' : 'A'));
+        }
+        return i;
+    }
+
+    static size_t ascii_case_mismatch_sse2(const char *a, const char *b, size_t size) {
+        size_t i = 0;
+        for (; i + 16 <= size; i += 16) {
+            const __m128i lower_a = flip_case_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i)), 'A');
+            const __m128i lower_b = flip_case_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i)), 'A');
+            const unsigned int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(lower_a, lower_b));
+            if (mask != 0xFFFF)
+                return i + __builtin_ctz(~mask);
+        }
+        return i;
+    }
+
+    TM_TARGET_AVX2 static __m256i flip_case_avx2(__m256i block, char first) {
+        const __m256i shifted = _mm256_sub_epi8(block, _mm256_set1_epi8((char)(first + 128)));
+        const __m256i in_range = _mm256_cmpgt_epi8(_mm256_set1_epi8(-128 + 26), shifted);
+        return _mm256_xor_si256(block, _mm256_and_si256(in_range, _mm256_set1_epi8(0x20)));
+    }
+
+    template <bool Upper>
+    TM_TARGET_AVX2 static size_t convert_ascii_case_avx2(char *data, size_t size) {
+        size_t i = 0;
+        for (; i + 32 <= size; i += 32) {
+            auto position = reinterpret_cast<__m256i *>(data + i);
+            _mm256_storeu_si256(position, flip_case_avx2(_mm256_loadu_si256(position), Upper ? 'a' : 'A'));
+        }
+        return i;
+    }
+
+    TM_TARGET_AVX2 static size_t ascii_case_mismatch_avx2(const char *a, const char *b, size_t size) {
+        size_t i = 0;
+        for (; i + 32 <= size; i += 32) {
+            const __m256i lower_a = flip_case_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i)), 'A');
+            const __m256i lower_b = flip_case_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i)), 'A');
+            const unsigned int mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(lower_a, lower_b));
+            if (mask != 0xFFFFFFFF)
+                return i + __builtin_ctz(~mask);
+        }
+        return i;
+    }
+
+    // \t through \r are contiguous, so they are found with the same
+    // shifted signed compare as flip_case_sse2, plus a check for space.
+    static unsigned int whitespace_mask_sse2(const char *position) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(position));
+        const __m128i shifted = _mm_sub_epi8(block, _mm_set1_epi8((char)('\t' + 128)));
+        const __m128i controls = _mm_cmplt_epi8(shifted, _mm_set1_epi8(-128 + 5));
+        const __m128i spaces = _mm_cmpeq_epi8(block, _mm_set1_epi8(' '));
+        return (unsigned int)_mm_movemask_epi8(_mm_or_si128(controls, spaces));
+    }
+
+    // Returns the index of the first match in the SIMD-sized prefix,
+    // or the length of that prefix so the caller can finish the tail.
+    template <bool Whitespace>
+    static size_t find_whitespace_sse2(const char *data, size_t size) {
+        size_t i = 0;
+        for (; i + 16 <= size; i += 16) {
+            unsigned int mask = whitespace_mask_sse2(data + i);
+            if (!Whitespace)
+                mask = ~mask & 0xFFFF;
+            if (mask)
+                return i + __builtin_ctz(mask);
+        }
+        return i;
+    }
+
+    TM_TARGET_AVX2 static unsigned int whitespace_mask_avx2(const char *position) {
+        const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(position));
+        const __m256i shifted = _mm256_sub_epi8(block, _mm256_set1_epi8((char)('\t' + 128)));
+        const __m256i controls = _mm256_cmpgt_epi8(_mm256_set1_epi8(-128 + 5), shifted);
+        const __m256i spaces = _mm256_cmpeq_epi8(block, _mm256_set1_epi8(' '));
+        return (unsigned int)_mm256_movemask_epi8(_mm256_or_si256(controls, spaces));
+    }
+
+    template <bool Whitespace>
+    TM_TARGET_AVX2 static size_t find_whitespace_avx2(const char *data, size_t size) {
+        size_t i = 0;
+        for (; i + 32 <= size; i += 32) {
+            unsigned int mask = whitespace_mask_avx2(data + i);
+            if (!Whitespace)
+                mask = ~mask;
+            if (mask)
+                return i + __builtin_ctz(mask);
+        }
+        return i;
+    }
+    static size_t rstrip_whitespace_sse2(const char *data, size_t size) {
+        while (size >= 16) {
+            const unsigned int mask = ~whitespace_mask_sse2(data + size - 16) & 0xFFFF;
+            if (mask)
+                return size - 16 + (32 - __builtin_clz(mask));
+            size -= 16;
+        }
+        return size;
+    }
+
+    TM_TARGET_AVX2 static size_t rstrip_whitespace_avx2(const char *data, size_t size) {
+        while (size >= 32) {
+            const unsigned int mask = ~whitespace_mask_avx2(data + size - 32);
+            if (mask)
+                return size - 32 + (32 - __builtin_clz(mask));
+            size -= 32;
+        }
+        return size;
+    }
+
+    // Each block is compared against the bytes to drop. A block with
+    // nothing to drop is stored whole at the write position (or left
+    // alone if nothing has been dropped yet); otherwise its kept bytes
+    // are copied one by one. The store never reaches past the block
+    // just loaded, since the write position trails the read position.
+    template <Removal Mode>
+    static size_t compact_sse2(char *data, size_t size, const char *set, size_t set_size, size_t &write) {
+        __m128i needles[MAX_SIMD_SET_SIZE];
+        for (size_t j = 0; j < set_size; j++)
+            needles[j] = _mm_set1_epi8(set[j]);
+        unsigned int carry = 0;
+        size_t i = 0;
+        write = 0;
+        for (; i + 16 <= size; i += 16) {
+            const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+            unsigned int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, needles[0]));
+            if constexpr (Mode == Removal::Set) {
+                for (size_t j = 1; j < set_size; j++)
+                    mask |= _mm_movemask_epi8(_mm_cmpeq_epi8(block, needles[j]));
+            } else if constexpr (Mode == Removal::Run) {
+                const unsigned int next_carry = mask >> 15;
+                mask &= (mask << 1) | carry;
+                carry = next_carry;
+            }
+            if (mask == 0) {
+                if (write != i)
+                    _mm_storeu_si128(reinterpret_cast<__m128i *>(data + write), block);
+                write += 16;
+                continue;
+            }
+            alignas(16) char bytes[16];
+            _mm_store_si128(reinterpret_cast<__m128i *>(bytes), block);
+            for (unsigned int keep = ~mask & 0xFFFF; keep; keep &= keep - 1)
+                data[write++] = bytes[__builtin_ctz(keep)];
+        }
+        return i;
+    }
+
+    template <Removal Mode>
+    TM_TARGET_AVX2 static size_t compact_avx2(char *data, size_t size, const char *set, size_t set_size, size_t &write) {
+        __m256i needles[MAX_SIMD_SET_SIZE];
+        for (size_t j = 0; j < set_size; j++)
+            needles[j] = _mm256_set1_epi8(set[j]);
+        unsigned int carry = 0;
+        size_t i = 0;
+        write = 0;
+        for (; i + 32 <= size; i += 32) {
+            const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+            unsigned int mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needles[0]));
+            if constexpr (Mode == Removal::Set) {
+                for (size_t j = 1; j < set_size; j++)
+                    mask |= _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needles[j]));
+            } else if constexpr (Mode == Removal::Run) {
+                const unsigned int next_carry = mask >> 31;
+                mask &= (mask << 1) | carry;
+                carry = next_carry;
+            }
+            if (mask == 0) {
+                if (write != i)
+                    _mm256_storeu_si256(reinterpret_cast<__m256i *>(data + write), block);
+                write += 32;
+                continue;
+            }
+            alignas(32) char bytes[32];
+            _mm256_store_si256(reinterpret_cast<__m256i *>(bytes), block);
+            for (unsigned int keep = ~mask; keep; keep &= keep - 1)
+                data[write++] = bytes[__builtin_ctz(keep)];
+        }
+        return i;
+    }
+#endif
+};
+
+}
@@ -3,6 +3,8 @@
 #include <cassert>
 #include <cstddef>
 
+#include "tm/simd.hpp"
+
 namespace TM {
 
 template <typename T>
@@ -129,6 +131,92 @@ public:
      */
     const T *data() const { return m_data; }
 
+    /**
+     * Returns the index of the first item equal to the given value,
+     * or -1 if it is not found.
+     *
+     * ```
+     * const uint32_t list[] = { 10, 20, 30, 20 };
+     * Span span { list, 4 };
+     * assert_eq(1, span.find(20));
+     * assert_eq(-1, span.find(40));
+     * ```
+     *
+     * Spans of integral, pointer and floating-point types are searched
+     * with SIMD instructions when the CPU supports them (see SIMD).
+     */
+    ssize_t find(const T &value) const {
+        return SIMD::find<T>(m_data, m_size, value);
+    }
+
+    /**
+     * Returns true if the span has an item equal to the given value.
+     *
+     * ```
+     * const char list[] = { 'a', 'b', 'c' };
+     * Span span { list, 3 };
+     * assert(span.contains('c'));
+     * assert_not(span.slice(0, 2).contains('c'));
+     * ```
+     */
+    bool contains(const T &value) const {
+        return find(value) != -1;
+    }
+
+    /**
+     * Returns the number of items equal to the given value.
+     *
+     * ```
+     * const int list[] = { 1, 2, 1, 2, 1 };
+     * Span span { list, 5 };
+     * assert_eq(3, span.count(1));
+     * ```
+     */
+    size_t count(const T &value) const {
+        return SIMD::count<T>(m_data, m_size, value);
+    }
+
+    /**
+     * Returns the index of the first item *not* equal to the
+     * given value, or -1 if every item is equal to it.
+     *
+     * ```
+     * const char list[] = { ' ', ' ', 'x', ' ' };
+     * Span span { list, 4 };
+     * assert_eq(2, span.index_of_first_not(' '));
+     * assert_eq(-1, span.slice(0, 2).index_of_first_not(' '));
+     * ```
+     */
+    ssize_t index_of_first_not(const T &value) const {
+        return SIMD::index_of_first_not<T>(m_data, m_size, value);
+    }
+
+    /**
+     * Returns the smallest item, compared with <.
+     *
+     * ```
+     * const int list[] = { 3, -1, 4, 1, -5, 9 };
+     * Span span { list, 6 };
+     * assert_eq(-5, span.min());
+     * ```
+     */
+    T min() const {
+        return SIMD::min<T>(m_data, m_size);
+    }
+
+    /**
+     * Returns the largest item, compared with <.
+     *
+     * ```
+     * const float list[] = { 3.5, -1, 4.25, 1 };
+     * Span span { list, 4 };
+     * assert_eq(4.25, span.max());
+     * ```
+     */
+    T max() const {
+        return SIMD::max<T>(m_data, m_size);
+    }
+
     class iterator {
     public:
         iterator(const Span<T> &span, const size_t index)
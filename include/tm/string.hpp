@@ -2,14 +2,25 @@
 
 #include <algorithm>
 #include <assert.h>
+#include <atomic>
 #include <ctype.h>
 #include <limits.h>
+#include <new>
 #include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
 
+#include "tm/format_string.hpp"
+#include "tm/number_formatter.hpp"
+#include "tm/number_parser.hpp"
+#include "tm/simd.hpp"
+#include "tm/vector.hpp"
+
 namespace TM {
 
+template <size_t N>
+class StringConcat;
+
 class String final {
 public:
     static constexpr int STRING_GROW_FACTOR = 2;
@@ -21,6 +32,25 @@ public:
      * auto str = String();
      * assert_eq(0, str.size());
      * ```
+     *
+     * No memory is allocated until characters are added,
+     * so empty Strings cost zero heap operations, even when copied.
+     *
+     * ```
+     * auto counter = AllocationCounter();
+     * {
+     *     auto str1 = String();
+     *     auto str2 = String(str1);
+     *     auto str3 = String("");
+     *     auto str4 = String { 0, 'x' };
+     *     str1 = str3;
+     *     str2 = "";
+     *     str4.append("");
+     *     assert_str_eq("", str1);
+     * }
+     * assert_eq(0, counter.allocations());
+     * assert_eq(0, counter.frees());
+     * ```
      */
     String() { }
 
@@ -61,17 +91,47 @@ public:
     }
 
     /**
-     * Constructs a new String by copying the contents
-     * from an existing String.
+     * Constructs a new String sharing the buffer of an existing
+     * String. The buffer is copied the first time either String
+     * is modified.
      *
      * ```
      * auto str1 = String { "foo" };
      * auto str2 = String { str1 };
      * assert_str_eq("foo", str2);
+     * assert_eq(str1.c_str(), str2.c_str());
+     *
+     * str2.append("bar");
+     * assert_str_eq("foo", str1);
+     * assert_str_eq("foobar", str2);
+     * assert(str1.c_str() != str2.c_str());
+     * ```
+     *
+     * The shared buffer's refcount is atomic, so copies can be
+     * made and dropped from several threads at once.
+     *
+     * ```
+     * // top-level ----
+     * #include <thread>
+     * // end-top-level ----
+     * const auto str = String { "shared between threads" };
+     * std::thread threads[4];
+     * for (auto &thread : threads) {
+     *     thread = std::thread([&str]() {
+     *         for (int i = 0; i < 1000; i++) {
+     *             auto copy = String { str };
+     *             if (i % 2 == 0)
+     *                 copy.append("!");
+     *         }
+     *     });
+     * }
+     * for (auto &thread : threads)
+     *     thread.join();
+     * assert_str_eq("shared between threads", str);
      * ```
      */
     String(const String &other) {
-        set_str(other.c_str(), other.size());
+        share_buffer_of(other);
     }
 
     /**
@@ -89,10 +149,14 @@ public:
         m_str = other.m_str;
         m_length = other.m_length;
         m_capacity = other.m_capacity;
+        m_refcount = other.m_refcount;
+        m_shareable = other.m_shareable;
 
         other.m_str = nullptr;
         other.m_length = 0;
         other.m_capacity = 0;
+        other.m_refcount = nullptr;
+        other.m_shareable = true;
     }
 
     /**
@@ -107,7 +171,7 @@ public:
      */
     String(const String *const other) {
         assert(other);
-        set_str(other->c_str(), other->size());
+        share_buffer_of(*other);
     }
 
     /**
@@ -132,14 +196,18 @@ public:
      * assert_str_eq("xxxxxxxxxx", str);
      * assert_eq(10, str.size());
      *
+     * assert_eq(10, strlen(str.c_str()));
+     *
      * auto str2 = String { 0, 'y' };
      * assert_str_eq("", str2);
      * assert_eq(0, str2.size());
      * ```
      */
     String(const size_t length, const char c) {
+        if (length == 0) return;
         grow(length);
         memset(m_str, c, sizeof(char) * length);
+        m_str[length] = 0;
         m_length = length;
     }
 
@@ -152,10 +220,7 @@ public:
      * ```
      */
     String(const long long number) {
-        const int length = snprintf(NULL, 0, "%lli", number);
-        char buf[length + 1];
-        snprintf(buf, length + 1, "%lli", number);
-        set_str(buf);
+        append_int(number);
     }
 
     /**
@@ -168,10 +233,7 @@ public:
      */
 
     String(const unsigned long long number) {
-        const int length = snprintf(NULL, 0, "%llu", number);
-        char buf[length + 1];
-        snprintf(buf, length + 1, "%llu", number);
-        set_str(buf);
+        append_uint(number);
     }
 
     /**
@@ -185,10 +247,7 @@ public:
      * ```
      */
     String(const long int number) {
-        const int length = snprintf(NULL, 0, "%li", number);
-        char buf[length + 1];
-        snprintf(buf, length + 1, "%li", number);
-        set_str(buf);
+        append_int(number);
     }
 
     /**
@@ -200,10 +259,7 @@ public:
      * ```
      */
     String(const int number) {
-        const int length = snprintf(NULL, 0, "%d", number);
-        char buf[length + 1];
-        snprintf(buf, length + 1, "%d", number);
-        set_str(buf);
+        append_int(number);
     }
 
     /**
@@ -215,10 +271,7 @@ public:
      * ```
      */
     String(const unsigned long number) {
-        const int length = snprintf(NULL, 0, "%lu", number);
-        char buf[length + 1];
-        snprintf(buf, length + 1, "%lu", number);
-        set_str(buf);
+        append_uint(number);
     }
 
     /**
@@ -230,10 +283,7 @@ public:
      * ```
      */
     String(const unsigned int number) {
-        const int length = snprintf(NULL, 0, "%u", number);
-        char buf[length + 1];
-        snprintf(buf, length + 1, "%u", number);
-        set_str(buf);
+        append_uint(number);
     }
 
     /**
@@ -251,12 +301,27 @@ public:
      * auto str = String { 4.1, 1 };
      * assert_str_eq("4.1", str);
      * ```
+     *
+     * Numbers of any magnitude are supported.
+     *
+     * ```
+     * auto str = String { 1e300, 2 };
+     * assert_eq(304, str.size());
+     * assert_str_eq(".00", str.substring(301));
+     * ```
      */
     String(const double number, const int precision = 4) {
-        const int length = snprintf(NULL, 0, "%.*f", precision, number);
-        char buf[length + 1];
-        snprintf(buf, length + 1, "%.*f", precision, number);
-        set_str(buf);
+        char buf[64];
+        const int length = snprintf(buf, sizeof(buf), "%.*f", precision, number);
+        assert(length >= 0);
+        if ((size_t)length < sizeof(buf)) {
+            set_str(buf, length);
+            return;
+        }
+        // huge magnitudes: format straight into a buffer of the right size
+        grow(length);
+        snprintf(m_str, length + 1, "%.*f", precision, number);
+        m_length = length;
     }
 
     /**
@@ -279,11 +344,11 @@ public:
      */
     static String create_and_take_ownership(char *buf, const size_t length) {
         String result;
-        auto old_m_str = result.m_str;
         result.m_str = buf;
         result.m_length = length;
         result.m_capacity = length;
-        delete[] old_m_str;
+        // the buffer has no header, so it gets an empty one of its own
+        allocate_buffer(0, result.m_refcount);
         return result;
     }
 
@@ -329,23 +394,32 @@ public:
     }
 
     ~String() {
-        delete[] m_str;
+        release_buffer();
     }
 
     /**
-     * Replaces the String data by copying from an another String.
+     * Replaces the String data by sharing the buffer of another
+     * String, releasing the current one.
      *
      * ```
      * auto str1 = String { "foo" };
-     * auto str2 = String { str1 };
+     * auto str2 = String { "bar" };
+     * str2 = str1;
+     * assert_str_eq("foo", str2);
+     * assert_eq(str1.c_str(), str2.c_str());
+     *
+     * str1[0] = 'g';
+     * assert_str_eq("goo", str1);
      * assert_str_eq("foo", str2);
      * ```
      */
     String &operator=(const String &other) {
-        if (m_str == other.m_str)
+        if (m_str == other.m_str) {
             m_length = other.m_length;
-        else
-            set_str(other.c_str(), other.size());
+        } else {
+            release_buffer();
+            share_buffer_of(other);
+        }
         return *this;
     }
 
@@ -360,24 +434,31 @@ public:
      * ```
      */
     String &operator=(String &&other) {
-        if (m_str == other.m_str)
-            m_length = other.m_length;
-        else {
-            delete[] m_str;
+        // copies may share a buffer, so only self-assignment can be skipped
+        if (this == &other)
+            return *this;
 
-            m_str = other.m_str;
-            m_length = other.m_length;
-            m_capacity = other.m_capacity;
+        release_buffer();
 
-            other.m_str = nullptr;
-            other.m_length = 0;
-            other.m_capacity = 0;
-        }
+        m_str = other.m_str;
+        m_length = other.m_length;
+        m_capacity = other.m_capacity;
+        m_refcount = other.m_refcount;
+        m_shareable = other.m_shareable;
+
+        other.m_str = nullptr;
+        other.m_length = 0;
+        other.m_capacity = 0;
+        other.m_refcount = nullptr;
+        other.m_shareable = true;
         return *this;
     }
 
     /**
-     * Appends two Strings together and returns the result.
+     * Appends two Strings together. The result is a StringConcat,
+     * which collects the operands of a chain like `a + b + c` and
+     * copies them into a new String with a single allocation when
+     * it is converted.
      *
      * ```
      * auto str1 = String { "foo" };
@@ -387,11 +468,10 @@ public:
      * assert_str_eq("12", String("1") + "2");
      * ```
      */
-    String operator+(const String &other) const {
-        auto new_string = String(*this);
-        new_string.append(other);
-        return new_string;
-    }
+    StringConcat<2> operator+(const String &other) const;
+
+    template <size_t N>
+    StringConcat<2> operator+(const char (&other)[N]) const;
 
     /**
      * Replaces the String data by copying from an a C string.
@@ -462,10 +542,26 @@ public:
      * assert_eq('r', str[1]);
      * ```
      *
+     * The reference can be written to after the String has been
+     * copied, so the buffer stops being shared from then on:
+     * later copies get their own bytes.
+     *
+     * ```
+     * auto str1 = String { "abc" };
+     * char &c = str1[0];
+     * auto str2 = str1;
+     * c = 'x';
+     * assert_str_eq("xbc", str1);
+     * assert_str_eq("abc", str2);
+     * assert(str1.c_str() != str2.c_str());
+     * ```
+     *
      * WARNING: This method does *not* check that the given
      * index is within the bounds of the string data!
      */
     char &operator[](const size_t index) {
+        will_modify();
+        m_shareable = false;
         return m_str[index];
     }
 
@@ -507,17 +603,22 @@ public:
      * ```
      */
     char pop_char() {
+        will_modify();
         assert(m_length > 0);
         return m_str[--m_length];
     }
 
     /**
-     * Returns a new copy of the String.
+     * Returns a new copy of the String. The copy shares the
+     * buffer until either String is modified.
      *
      * ```
      * auto str1 = String { "abc" };
      * auto str2 = str1.clone();
      * assert_str_eq("abc", str2);
+     * str2.truncate(1);
+     * assert_str_eq("abc", str1);
+     * assert_str_eq("a", str2);
      * assert_neq(str1.c_str(), str2.c_str()); // not the same pointer
      * ```
      */
@@ -648,14 +749,17 @@ public:
      */
     void set_str(const char *const str, const size_t length) {
         assert(str);
+        if (is_shared())
+            release_buffer();
+        if (length == 0 && !m_str) return;
         if (m_capacity > 0 && length <= m_capacity) {
             memcpy(m_str, str, sizeof(char) * length);
             m_str[length] = 0;
             m_length = length;
             return;
         }
-        delete[] m_str;
-        m_str = new char[length + 1];
+        release_buffer();
+        m_str = allocate_buffer(length, m_refcount);
         memcpy(m_str, str, sizeof(char) * length);
         m_str[length] = 0;
         m_length = length;
@@ -673,6 +777,7 @@ public:
      * ```
      */
     void prepend_char(const char c) {
+        will_modify();
         const size_t total_length = m_length + 1;
         grow_at_least(total_length);
         memmove(m_str + 1, m_str, m_length + 1); // 1 extra for null terminator
@@ -690,9 +795,8 @@ public:
      * ```
      */
     void prepend(long long i) {
-        const int length = snprintf(NULL, 0, "%lli", i);
-        char buf[length + 1];
-        snprintf(buf, length + 1, "%lli", i);
+        char buf[NumberFormatter::MAX_INT_LENGTH + 1];
+        buf[NumberFormatter::format_int(i, buf)] = 0;
         prepend(buf);
     }
 
@@ -706,6 +810,7 @@ public:
      * ```
      */
     void prepend(const char *const str) {
+        will_modify();
         if (!str) return;
         const size_t new_length = strlen(str);
         if (new_length == 0) return;
@@ -726,6 +831,7 @@ public:
      * ```
      */
     void prepend(const String &str) {
+        will_modify();
         const size_t new_length = str.size();
         if (new_length == 0) return;
         grow_at_least(new_length + m_length);
@@ -753,6 +859,7 @@ public:
      * ```
      */
     void insert(const size_t index, const char c) {
+        will_modify();
         assert(index < m_length);
         grow_at_least(m_length + 1);
         const size_t nbytes = m_length - index + 1; // 1 extra for null terminator
@@ -777,6 +884,7 @@ public:
      * ```
      */
     void replace_bytes(const size_t index, const size_t length, const String &replacement) {
+        will_modify();
         assert(index < m_length);
         assert(index + length <= m_length);
         const ssize_t diff = replacement.size() - length;
@@ -803,6 +911,7 @@ public:
      * ```
      */
     void append_char(const char c) {
+        will_modify();
         const size_t total_length = m_length + 1;
         grow_at_least(total_length);
         m_str[total_length - 1] = c;
@@ -820,6 +929,7 @@ public:
      * ```
      */
     void append(const signed char c) {
+        will_modify();
         const size_t total_length = m_length + 1;
         grow_at_least(total_length);
         m_str[total_length - 1] = c;
@@ -863,10 +973,7 @@ public:
      * ```
      */
     void append(const size_t i) {
-        const int length = snprintf(NULL, 0, "%zu", i);
-        char buf[length + 1];
-        snprintf(buf, length + 1, "%zu", i);
-        append(buf);
+        append_uint(i);
     }
 
     /**
@@ -879,10 +986,7 @@ public:
      * ```
      */
     void append(const ssize_t i) {
-        const int length = snprintf(NULL, 0, "%zd", i);
-        char buf[length + 1];
-        snprintf(buf, length + 1, "%zd", i);
-        append(buf);
+        append_int(i);
     }
 
     /**
@@ -895,10 +999,7 @@ public:
      * ```
      */
     void append(const long long i) {
-        const int length = snprintf(NULL, 0, "%lli", i);
-        char buf[length + 1];
-        snprintf(buf, length + 1, "%lli", i);
-        append(buf);
+        append_int(i);
     }
 
     /**
@@ -911,10 +1012,72 @@ public:
      * ```
      */
     void append(const int i) {
-        const int length = snprintf(NULL, 0, "%i", i);
-        char buf[length + 1];
-        snprintf(buf, length + 1, "%i", i);
-        append(buf);
+        append_int(i);
+    }
+
+    /**
+     * Appends the decimal digits of the given number,
+     * written straight into this String's buffer.
+     *
+     * ```
+     * auto str = String { "a" };
+     * str.append_int(-123);
+     * assert_str_eq("a-123", str);
+     * str.append_int(-9223372036854775807LL - 1);
+     * assert_str_eq("a-123-9223372036854775808", str);
+     * ```
+     */
+    void append_int(const long long number) {
+        if (number >= 0) {
+            append_uint(number);
+            return;
+        }
+        append_char('-');
+        // negate in unsigned space so LLONG_MIN does not overflow
+        append_uint(0ULL - (unsigned long long)number);
+    }
+
+    /**
+     * Appends the decimal digits of the given number,
+     * written straight into this String's buffer.
+     *
+     * ```
+     * auto str = String { "a" };
+     * str.append_uint(0);
+     * str.append_uint(18446744073709551615ULL);
+     * assert_str_eq("a018446744073709551615", str);
+     * ```
+     */
+    void append_uint(const unsigned long long number) {
+        will_modify();
+        const size_t total_length = m_length + NumberFormatter::digit_count(number);
+        grow_at_least(total_length);
+        NumberFormatter::format_uint(number, m_str + m_length);
+        m_length = total_length;
+        m_str[m_length] = 0;
+    }
+
+    /**
+     * Appends the shortest decimal representation of the
+     * given double that reads back as the same value.
+     * See NumberFormatter::format_double for the format.
+     *
+     * ```
+     * auto str = String { "x=" };
+     * str.append_double(0.1);
+     * assert_str_eq("x=0.1", str);
+     * str.append_double(-2);
+     * assert_str_eq("x=0.1-2.0", str);
+     * str.clear();
+     * str.append_double(1e100);
+     * assert_str_eq("1.0e+100", str);
+     * ```
+     */
+    void append_double(const double number) {
+        will_modify();
+        grow_at_least(m_length + NumberFormatter::MAX_DOUBLE_LENGTH);
+        m_length += NumberFormatter::format_double(number, m_str + m_length);
+        m_str[m_length] = 0;
     }
 
     /**
@@ -949,6 +1112,7 @@ public:
      * ```
      */
     void append(const char *const str, const size_t length) {
+        will_modify();
         if (!str) return;
         if (length == 0) return;
         const size_t total_length = m_length + length;
@@ -979,15 +1143,38 @@ public:
 
     /**
      * Appends the given va_list args, formatting using the specified format.
+     *
+     * The output is written straight into this String's spare
+     * capacity. Only when it does not fit is the buffer grown
+     * and the arguments formatted a second time.
+     *
+     * ```
+     * auto str = String { "x" };
+     * str.append_sprintf("%s", String(1000, 'y').c_str());
+     * assert_eq(1001, str.size());
+     * assert_eq('y', str[1000]);
+     * str.append_sprintf("%d%s", 2, "z");
+     * assert_str_eq("2z", str.substring(1001));
+     * str.append_sprintf("%s", "");
+     * assert_eq(1003, str.size());
+     * ```
      */
     void append_vsprintf(const char *const format, va_list args) {
+        will_modify();
+        // make room for about the size of the format string so
+        // short results usually fit on the first try
+        grow_at_least(m_length + strlen(format) + 16);
         va_list args_copy;
         va_copy(args_copy, args);
-        const int fmt_length = vsnprintf(nullptr, 0, format, args_copy);
+        const size_t available = m_capacity - m_length;
+        const int length = vsnprintf(m_str + m_length, available + 1, format, args_copy);
         va_end(args_copy);
-        char buf[fmt_length + 1];
-        vsnprintf(buf, fmt_length + 1, format, args);
-        append(buf);
+        assert(length >= 0);
+        if ((size_t)length > available) {
+            grow_at_least(m_length + length);
+            vsnprintf(m_str + m_length, length + 1, format, args);
+        }
+        m_length += length;
     }
 
     /**
@@ -1001,6 +1188,7 @@ public:
      * ```
      */
     void append(const String &str) {
+        will_modify();
         if (str.size() == 0) return;
         const size_t total_length = m_length + str.size();
         grow_at_least(total_length);
@@ -1019,6 +1207,7 @@ public:
      * ```
      */
     void append(const size_t n, const char c) {
+        will_modify();
         const size_t total_length = m_length + n;
         grow_at_least(total_length);
         memset(m_str + m_length, c, sizeof(char) * n);
@@ -1237,6 +1426,17 @@ public:
      * auto str4 = String { "defdef" };
      * assert_eq(-1, str2.casecmp(str4));
      * ```
+     *
+     * Long Strings are compared 16 or 32 bytes at a time.
+     *
+     * ```
+     * auto header1 = String { "Accept-Encoding: GZIP, Deflate, BR" };
+     * auto header2 = String { "accept-encoding: gzip, deflate, br" };
+     * auto header3 = String { "accept-encoding: gzip, deflate, bz" };
+     * assert_eq(0, header1.casecmp(header2));
+     * assert_eq(-1, header1.casecmp(header3));
+     * assert_eq(1, header3.casecmp(header1));
+     * ```
      */
     int casecmp(const String &other) const {
         if (m_length == 0) {
@@ -1245,12 +1445,11 @@ public:
             return -1;
         }
         auto lower = [&](char c) { return c >= 'A' && c <= 'Z' ? c + 32 : c; };
-        for (size_t i = 0; i < std::min(m_length, other.m_length); ++i) {
+        const size_t common_length = std::min(m_length, other.m_length);
+        const size_t i = SIMD::ascii_case_mismatch(m_str, other.m_str, common_length);
+        if (i < common_length) {
             const auto c1 = lower((unsigned char)(*this)[i]), c2 = lower((unsigned char)other[i]);
-            if (c1 < c2)
-                return -1;
-            else if (c1 > c2)
-                return 1;
+            return c1 < c2 ? -1 : 1;
         }
         if (m_length == other.m_length)
             return 0;
@@ -1271,18 +1470,21 @@ public:
      * auto str3 = String { "xx" };
      * assert_eq(-1, str1.find(str3));
      * ```
+     *
+     * Long haystacks are scanned with SIMD kernels where available.
+     *
+     * ```
+     * auto str = String { 100, 'a' };
+     * str.append("needle");
+     * str.append(100, 'a');
+     * assert_eq(100, str.find("needle"));
+     * assert_eq(-1, str.find("needles"));
+     * assert_eq(-1, String().find("a"));
+     * assert_eq(-1, str.find(""));
+     * ```
      */
     ssize_t find(const String &needle) const {
-        if (m_length < needle.size() || needle.is_empty())
-            return -1;
-        assert(m_str);
-        const size_t max_index = m_length - needle.size();
-        const size_t byte_count = sizeof(char) * needle.size();
-        for (size_t index = 0; index <= max_index; ++index) {
-            if (memcmp(m_str + index, needle.c_str(), byte_count) == 0)
-                return index;
-        }
-        return -1;
+        return find_from(needle, 0);
     }
 
     /**
@@ -1293,13 +1495,112 @@ public:
      * auto str = String { "hello world" };
      * assert_eq(6, str.find('w'));
      * assert_eq(-1, str.find('x'));
+     * assert_eq(-1, String().find('x'));
      * ```
      */
     ssize_t find(const char c) const {
-        for (size_t i = 0; i < m_length; ++i) {
-            if (c == m_str[i]) return i;
+        return find_from(c, 0);
+    }
+
+    /**
+     * Finds the given String inside this one, starting the search
+     * at the given byte offset, and return its starting index.
+     * If not found, return -1.
+     *
+     * ```
+     * auto str = String { "abcabcabc" };
+     * assert_eq(1, str.find_from("bc", 0));
+     * assert_eq(4, str.find_from("bc", 2));
+     * assert_eq(7, str.find_from("bc", 5));
+     * assert_eq(-1, str.find_from("bc", 8));
+     * assert_eq(-1, str.find_from("bc", 100));
+     * ```
+     */
+    ssize_t find_from(const String &needle, size_t offset) const {
+        if (offset >= m_length)
+            return -1;
+        const auto index = SIMD::find_substring(m_str + offset, m_length - offset, needle.m_str, needle.m_length);
+        return index == -1 ? -1 : index + offset;
+    }
+
+    /**
+     * Finds the given character inside this String, starting the
+     * search at the given byte offset, and return its index.
+     * If not found, return -1.
+     *
+     * ```
+     * auto str = String { "hello world" };
+     * assert_eq(2, str.find_from('l', 0));
+     * assert_eq(9, str.find_from('l', 4));
+     * assert_eq(-1, str.find_from('l', 10));
+     * ```
+     */
+    ssize_t find_from(const char c, size_t offset) const {
+        if (offset >= m_length)
+            return -1;
+        auto found = static_cast<const char *>(memchr(m_str + offset, c, m_length - offset));
+        return found ? found - m_str : -1;
+    }
+
+    /**
+     * Finds the last occurrence of the given String inside this
+     * one and return its starting index.
+     * If not found, return -1.
+     *
+     * ```
+     * auto str = String { "hello hello world" };
+     * assert_eq(6, str.rfind("hello"));
+     * assert_eq(-1, str.rfind("goodbye"));
+     * assert_eq(-1, str.rfind(""));
+     * assert_eq(-1, String().rfind("a"));
+     * ```
+     */
+    ssize_t rfind(const String &needle) const {
+        return SIMD::rfind_substring(m_str, m_length, needle.m_str, needle.m_length);
+    }
+
+    /**
+     * Finds the last occurrence of the given character inside
+     * this String and return its index.
+     * If not found, return -1.
+     *
+     * ```
+     * auto str = String { "hello world" };
+     * assert_eq(9, str.rfind('l'));
+     * assert_eq(0, str.rfind('h'));
+     * assert_eq(-1, str.rfind('x'));
+     * assert_eq(-1, String().rfind('x'));
+     * ```
+     */
+    ssize_t rfind(const char c) const {
+        return SIMD::rfind_substring(m_str, m_length, &c, 1);
+    }
+
+    /**
+     * Returns the starting indices of every non-overlapping
+     * occurrence of the given String inside this one.
+     *
+     * ```
+     * auto str = String { "aaaa, aa" };
+     * auto indices = str.find_all("aa");
+     * assert_eq(3, indices.size());
+     * assert_eq(0, indices[0]);
+     * assert_eq(2, indices[1]);
+     * assert_eq(6, indices[2]);
+     * assert(str.find_all("b").is_empty());
+     * assert(str.find_all("").is_empty());
+     * ```
+     */
+    Vector<size_t> find_all(const String &needle) const {
+        Vector<size_t> indices;
+        if (needle.is_empty())
+            return indices;
+        auto index = find_from(needle, 0);
+        while (index != -1) {
+            indices.push((size_t)index);
+            index = find_from(needle, index + needle.m_length);
         }
-        return -1;
+        return indices;
     }
 
     /**
@@ -1322,11 +1623,9 @@ public:
     void truncate(const size_t length) {
         assert(length <= m_length);
         if (length == 0) {
-            delete[] m_str;
-            m_str = nullptr;
-            m_length = 0;
-            m_capacity = 0;
+            release_buffer();
         } else {
+            detach();
             m_str[length] = 0;
             m_length = length;
         }
@@ -1373,18 +1672,15 @@ public:
      * ```
      */
     void strip_trailing_whitespace() {
-        while (m_length > 0) {
-            switch (m_str[m_length - 1]) {
-            case ' ':
-            case '\t':
-            case '\n':
-            case '\r':
-                chomp();
+        size_t length = m_length;
+        while (length > 0) {
+            const char c = m_str[length - 1];
+            if (c != ' ' && c != '\t' && c != '\n' && c != '\r')
                 break;
-            default:
-                return;
-            }
+            length--;
         }
+        if (length < m_length)
+            truncate(length);
     }
 
     /**
@@ -1397,17 +1693,73 @@ public:
      * ```
      */
     void strip_trailing_spaces() {
-        while (m_length > 0) {
-            if (m_str[m_length - 1] == ' ')
-                chomp();
-            else
-                return;
+        size_t length = m_length;
+        while (length > 0 && m_str[length - 1] == ' ')
+            length--;
+        if (length < m_length)
+            truncate(length);
+    }
+
+    /**
+     * Removes leading and trailing ASCII whitespace (space, \t,
+     * \n, \v, \f and \r) in place, like StringView::strip().
+     *
+     * ```
+     * auto str = String { " \t foo bar \r\n" };
+     * str.strip();
+     * assert_str_eq("foo bar", str);
+     *
+     * str = String(100, ' ');
+     * str.strip();
+     * assert(str.is_empty());
+     * ```
+     */
+    void strip() {
+        rstrip();
+        lstrip();
+    }
+
+    /**
+     * Removes leading ASCII whitespace in place.
+     *
+     * ```
+     * auto str = String { "\n\n  foo " };
+     * str.lstrip();
+     * assert_str_eq("foo ", str);
+     * ```
+     */
+    void lstrip() {
+        const ssize_t start = SIMD::index_of_first_not_ascii_whitespace(m_str, m_length);
+        if (start == 0)
+            return;
+        if (start == -1) {
+            truncate(0);
+            return;
         }
+        will_modify();
+        m_length -= start;
+        memmove(m_str, m_str + start, m_length + 1);
+    }
+
+    /**
+     * Removes trailing ASCII whitespace in place. Unlike
+     * strip_trailing_whitespace(), this includes \v and \f.
+     *
+     * ```
+     * auto str = String { " foo\f\v\n" };
+     * str.rstrip();
+     * assert_str_eq(" foo", str);
+     * ```
+     */
+    void rstrip() {
+        const size_t length = SIMD::size_without_trailing_ascii_whitespace(m_str, m_length);
+        if (length < m_length)
+            truncate(length);
     }
 
     /**
      * Removes all occurrences of the given character
-     * from the String.
+     * from the String, in a single pass. See SIMD::remove.
      *
      * ```
      * auto str = String { "abcabac" };
@@ -1416,16 +1768,54 @@ public:
      * ```
      */
     void remove(const char character) {
-        assert(m_str);
-        for (size_t i = 0; i < m_length; ++i) {
-            if (m_str[i] == character) {
-                for (size_t j = i; j < m_length; ++j)
-                    m_str[j] = m_str[j + 1];
+        will_modify();
+        if (!m_str) return;
+        m_length = SIMD::remove(m_str, m_length, character);
+        m_str[m_length] = '\0';
+    }
 
-                --m_length;
-                --i;
-            }
-        }
+    /**
+     * Removes every character that appears in the given
+     * set, in a single pass. See SIMD::remove_any.
+     *
+     * ```
+     * auto str = String { "(555) 123-4567" };
+     * str.remove_any("() -");
+     * assert_str_eq("5551234567", str);
+     * str.remove_any(String("57"));
+     * assert_str_eq("12346", str);
+     * ```
+     */
+    void remove_any(const char *set) {
+        assert(set);
+        remove_any(set, strlen(set));
+    }
+
+    void remove_any(const String &set) {
+        remove_any(set.c_str(), set.size());
+    }
+
+    void remove_any(const char *set, const size_t set_size) {
+        will_modify();
+        if (!m_str) return;
+        m_length = SIMD::remove_any(m_str, m_length, set, set_size);
+        m_str[m_length] = '\0';
+    }
+
+    /**
+     * Collapses each run of the given character into a
+     * single one, in a single pass. See SIMD::squeeze.
+     *
+     * ```
+     * auto str = String { "a  b\t\t c    d" };
+     * str.squeeze(' ');
+     * assert_str_eq("a b\t\t c d", str);
+     * ```
+     */
+    void squeeze(const char character) {
+        will_modify();
+        if (!m_str) return;
+        m_length = SIMD::squeeze(m_str, m_length, character);
         m_str[m_length] = '\0';
     }
 
@@ -1459,6 +1849,53 @@ public:
         return true;
     }
 
+    /**
+     * Parses a decimal integer from the start of this String.
+     * If consumed is given, it is set to the number of bytes
+     * that were parsed. See NumberParser::parse_int64.
+     *
+     * ```
+     * assert_eq(-42, String("-42").to_int64().value());
+     * size_t consumed = 0;
+     * assert_eq(12, String("12px").to_int64(&consumed).value());
+     * assert_eq(2, consumed);
+     * assert_not(String("px").to_int64());
+     * assert_not(String().to_int64());
+     * ```
+     */
+    Optional<int64_t> to_int64(size_t *consumed = nullptr) const {
+        return NumberParser::parse_int64(m_str, m_length, consumed);
+    }
+
+    /**
+     * Parses an unsigned decimal integer from the start of this
+     * String. See NumberParser::parse_uint64.
+     *
+     * ```
+     * assert_eq(18446744073709551615ULL, String("18446744073709551615").to_uint64().value());
+     * assert_not(String("-1").to_uint64());
+     * ```
+     */
+    Optional<uint64_t> to_uint64(size_t *consumed = nullptr) const {
+        return NumberParser::parse_uint64(m_str, m_length, consumed);
+    }
+
+    /**
+     * Parses a decimal floating-point number from the start of
+     * this String, independent of locale. See NumberParser::parse_double.
+     *
+     * ```
+     * assert_eq(1.5, String("1.5").to_double().value());
+     * size_t consumed = 0;
+     * assert_eq(-2.5e-3, String("-2.5e-3,").to_double(&consumed).value());
+     * assert_eq(7, consumed);
+     * assert_not(String("abc").to_double());
+     * ```
+     */
+    Optional<double> to_double(size_t *consumed = nullptr) const {
+        return NumberParser::parse_double(m_str, m_length, consumed);
+    }
+
     /**
      * Returns a new String that is the result of incrementing
      * the last character of this String. If the the last character
@@ -1488,6 +1925,7 @@ public:
         } else if (last_char == '9') {
             result.increment_successive_char('0', '9', '1');
         } else {
+            result.detach();
             result.m_str[index]++;
         }
         return result;
@@ -1505,51 +1943,100 @@ public:
      * auto str = String::format("{} {}orld {}", cstr, c, num);
      * assert_str_eq("hello world 999", str);
      * ```
+     *
+     * Placeholders without a matching argument are kept as-is,
+     * and extra arguments are ignored. A lone brace is not a
+     * placeholder.
+     *
+     * ```
+     * assert_str_eq("a b {}", String::format("a {} {}", 'b'));
+     * assert_str_eq("x", String::format("x", 1, 2));
+     * assert_str_eq("{a} {", String::format("{a} {", 1));
+     * assert_str_eq("{1}", String::format("{{}}", 1));
+     * assert_str_eq("", String::format(""));
+     * ```
      */
     template <typename... Args>
-    static String format(const char *const fmt, Args... args) {
+    static String format(const char *const fmt, const Args &...args) {
         String out {};
         format(out, fmt, args...);
         return out;
     }
 
-    static void format(String &out, const char *fmt) {
-        for (const char *c = fmt; *c != 0; c++) {
-            out.append_char(*c);
-        }
+    /**
+     * Appends the given arguments to the given String according to
+     * the given format. Literal text between placeholders is copied
+     * in one go, and the output is grown once up front using an
+     * estimate of the final size.
+     *
+     * ```
+     * auto str = String { "log: " };
+     * auto name = String { "world" };
+     * String::format(str, "hello {}, {} + {} = {}", name, 1, (size_t)2, 3LL);
+     * assert_str_eq("log: hello world, 1 + 2 = 3", str);
+     * ```
+     */
+    template <typename... Args>
+    static void format(String &out, const char *const fmt, const Args &...args) {
+        const size_t length = strlen(fmt);
+        out.grow_at_least(out.m_length + length + estimated_size(args...));
+        format_segments(out, fmt, fmt + length, args...);
     }
 
-    template <typename T, typename... Args>
-    static void format(String &out, const char *fmt, T first, Args... rest) {
-        for (const char *c = fmt; *c != 0; c++) {
-            if (*c == '{' && *(c + 1) == '}') {
-                out.append(first);
-                format(out, c + 2, rest...);
-                return;
-            } else {
-                out.append_char(*c);
-            }
-        }
+    /**
+     * Returns a new String by appending the given arguments according
+     * to the given FormatString, whose placeholders were already
+     * located, usually at compile time.
+     *
+     * ```
+     * static constexpr FormatString fmt { "{}: {}" };
+     * assert_str_eq("x: 1", String::format(fmt, 'x', 1));
+     * assert_str_eq("y: {}", String::format(fmt, 'y'));
+     * ```
+     */
+    template <size_t N, typename... Args>
+    static String format(const FormatString<N> &fmt, const Args &...args) {
+        String out {};
+        format(out, fmt, args...);
+        return out;
+    }
+
+    /**
+     * Appends the given arguments to the given String according
+     * to the given FormatString.
+     *
+     * ```
+     * auto str = String { ">" };
+     * String::format(str, FormatString { "{}{}" }, "a", String("b"));
+     * assert_str_eq(">ab", str);
+     * ```
+     */
+    template <size_t N, typename... Args>
+    static void format(String &out, const FormatString<N> &fmt, const Args &...args) {
+        out.grow_at_least(out.m_length + fmt.length() + estimated_size(args...));
+        format_placeholders(out, fmt, 0, 0, args...);
     }
 
     /**
-     * Returns a new String where every character is converted to uppercase.
+     * Returns a new String where every ASCII letter is converted to
+     * uppercase. Other bytes, including multibyte characters, are
+     * left as they are, regardless of locale.
      *
      * ```
      * auto str = String("hElLo");
      * assert_str_eq("HELLO", str.uppercase());
+     * assert_str_eq("CAFé", String("café").uppercase());
      * ```
      */
     String uppercase() const {
         auto new_str = String(this);
-        for (size_t i = 0; i < new_str.m_length; ++i) {
-            new_str.m_str[i] = toupper(new_str.m_str[i]);
-        }
+        new_str.uppercase_in_place();
         return new_str;
     }
 
     /**
-     * Returns a new String where every character is converted to lowercase.
+     * Returns a new String where every ASCII letter is converted to
+     * lowercase. Other bytes are left as they are, regardless of locale.
      *
      * ```
      * auto str = String("hElLo");
@@ -1558,12 +2045,40 @@ public:
      */
     String lowercase() const {
         auto new_str = String(this);
-        for (size_t i = 0; i < new_str.m_length; ++i) {
-            new_str.m_str[i] = tolower(new_str.m_str[i]);
-        }
+        new_str.lowercase_in_place();
         return new_str;
     }
 
+    /**
+     * Converts every ASCII letter in this String to uppercase,
+     * without copying. See SIMD::ascii_uppercase.
+     *
+     * ```
+     * auto str = String("content-length: 42");
+     * str.uppercase_in_place();
+     * assert_str_eq("CONTENT-LENGTH: 42", str);
+     * ```
+     */
+    void uppercase_in_place() {
+        will_modify();
+        SIMD::ascii_uppercase(m_str, m_length);
+    }
+
+    /**
+     * Converts every ASCII letter in this String to lowercase,
+     * without copying. See SIMD::ascii_lowercase.
+     *
+     * ```
+     * auto str = String("Content-Length: 42");
+     * str.lowercase_in_place();
+     * assert_str_eq("content-length: 42", str);
+     * ```
+     */
+    void lowercase_in_place() {
+        will_modify();
+        SIMD::ascii_lowercase(m_str, m_length);
+    }
+
     /**
      * Returns true if this String begins with the given String.
      *
@@ -1704,9 +2219,10 @@ public:
     }
 
     /**
-     * Prints the full string with printf(), character by character.
-     * This method will print the full String, even if null characters
-     * are encountered.
+     * Prints the full string to stdout followed by a newline,
+     * with a single fwrite() under one stdio lock. This method
+     * will print the full String, even if null characters are
+     * encountered. See OutputBuffer for writing many pieces.
      *
      * ```
      * auto str = String("foo\0bar");
@@ -1714,63 +2230,208 @@ public:
      * ```
      */
     void print() const {
-        for (size_t i = 0; i < m_length; ++i) {
-            printf("%c", (*this)[i]);
+        flockfile(stdout);
+        fwrite(c_str(), sizeof(char), m_length, stdout);
+        putc_unlocked('\n', stdout);
+        funlockfile(stdout);
+    }
+
+    /**
+     * Returns true if every byte in the String is 7-bit ASCII.
+     *
+     * ```
+     * assert(String("abc").is_ascii());
+     * assert(String().is_ascii());
+     * assert_not(String("caf\xC3\xA9").is_ascii());
+     * ```
+     */
+    bool is_ascii() const {
+        return SIMD::is_ascii(m_str, m_length);
+    }
+
+    /**
+     * Returns true if the String is well-formed UTF-8, rejecting
+     * overlong encodings, surrogates and code points above U+10FFFF.
+     * See SIMD::is_valid_utf8.
+     *
+     * ```
+     * assert(String("abc").is_valid_utf8());
+     * assert(String("🐄").is_valid_utf8());
+     * assert_not(String("\xC3").is_valid_utf8());
+     * assert_not(String("\xC0\x80").is_valid_utf8());
+     * ```
+     */
+    bool is_valid_utf8() const {
+        return SIMD::is_valid_utf8(m_str, m_length);
+    }
+
+    /**
+     * Returns the number of UTF-8 code points in the String.
+     * The result is only meaningful if the String is valid UTF-8.
+     *
+     * ```
+     * assert_eq(3, String("abc").utf8_length());
+     * assert_eq(4, String("ab☺🐄").utf8_length());
+     * assert_eq(0, String().utf8_length());
+     * ```
+     */
+    size_t utf8_length() const {
+        return SIMD::utf8_length(m_str, m_length);
+    }
+
+    /**
+     * Returns the character (UTF-8 code point) at the given
+     * character index as a new String.
+     *
+     * Each call counts characters from the start of the String,
+     * skipping whole blocks with SIMD::utf8_length. To look up
+     * many characters by index, build a CharIndexedView once
+     * instead.
+     *
+     * ```
+     * auto str = String { "aé☺🐄z" };
+     * assert_str_eq("a", str.char_at(0));
+     * assert_str_eq("é", str.char_at(1));
+     * assert_str_eq("☺", str.char_at(2));
+     * assert_str_eq("🐄", str.char_at(3));
+     * assert_str_eq("z", str.char_at(4));
+     *
+     * str.prepend("🐄");
+     * assert_str_eq("🐄", str.char_at(0));
+     * assert_str_eq("z", str.char_at(5));
+     * str[str.size() - 1] = 'y';
+     * assert_str_eq("y", str.char_at(5));
+     * ```
+     *
+     * This method aborts if the index is past the last character.
+     *
+     * ```should_abort
+     * auto str = String { "é" };
+     * str.char_at(1);
+     * ```
+     */
+    String char_at(const size_t index) const {
+        const size_t start = byte_offset_of_char(index);
+        assert(start < m_length);
+        size_t end = start + 1;
+        while (end < m_length && ((unsigned char)m_str[end] & 0xC0) == 0x80)
+            end++;
+        return String { m_str + start, end - start };
+    }
+
+    /**
+     * Returns the byte offset where the character (UTF-8 code
+     * point) at the given character index starts. Passing the
+     * number of characters returns the size of the String.
+     *
+     * ```
+     * auto str = String { "aé☺🐄z" };
+     * assert_eq(0, str.byte_offset_of_char(0));
+     * assert_eq(1, str.byte_offset_of_char(1));
+     * assert_eq(3, str.byte_offset_of_char(2));
+     * assert_eq(6, str.byte_offset_of_char(3));
+     * assert_eq(10, str.byte_offset_of_char(4));
+     * assert_eq(11, str.byte_offset_of_char(5));
+     *
+     * auto long_str = String();
+     * for (size_t i = 0; i < 1000; i++)
+     *     long_str.append(i % 3 == 0 ? "é" : "x");
+     * size_t expected = 0;
+     * for (size_t i = 0; i < 1000; i++) {
+     *     assert_eq(expected, long_str.byte_offset_of_char(i));
+     *     expected += i % 3 == 0 ? 2 : 1;
+     * }
+     * assert_eq(expected, long_str.byte_offset_of_char(1000));
+     * assert_eq(0, String().byte_offset_of_char(0));
+     * ```
+     *
+     * This method aborts if the index is past the end.
+     *
+     * ```should_abort
+     * auto str = String { "é" };
+     * str.byte_offset_of_char(2);
+     * ```
+     */
+    size_t byte_offset_of_char(const size_t index) const {
+        constexpr size_t block_size = 64;
+        size_t offset = 0;
+        size_t count = 0;
+        // only lead bytes are counted, so a block may split a character
+        while (m_length - offset >= block_size) {
+            const size_t block_count = SIMD::utf8_length(m_str + offset, block_size);
+            if (count + block_count > index)
+                break;
+            count += block_count;
+            offset += block_size;
+        }
+        for (; offset < m_length; offset++) {
+            if (((unsigned char)m_str[offset] & 0xC0) == 0x80)
+                continue;
+            if (count == index)
+                return offset;
+            count++;
         }
-        printf("\n");
+        assert(count == index);
+        return m_length;
     }
 
     /**
      * Returns true if the string contains UTF-8-encoded
-     * characters that seem to be valid, multibyte or not.
+     * characters that are valid, multibyte or not.
      *
      * An ASCII string "foo" would return true, because it's
      * also a valid UTF-8-encoded string. It can be
      * represented with UTF-8.
      *
-     * NOTE: This is not fool-proof. There's a lot of
-     * checks we aren't doing.
+     * This is the same check as is_valid_utf8(), so unlike the
+     * name suggests, sequences that only look right, such as
+     * overlong encodings or surrogates, are rejected too.
      *
      * ```
      * assert_eq(true, String("abc").contains_seemingly_valid_utf8_encoded_characters());
      * assert_eq(true, String("🐄").contains_seemingly_valid_utf8_encoded_characters());
      * assert_eq(false, String("\xC3").contains_seemingly_valid_utf8_encoded_characters());
+     * assert_eq(false, String("\xC0\x80").contains_seemingly_valid_utf8_encoded_characters());
+     * assert_eq(false, String("\xED\xA0\x80").contains_seemingly_valid_utf8_encoded_characters());
+     * assert_eq(false, String("\xC3\x28").contains_seemingly_valid_utf8_encoded_characters());
+     *
+     * auto long_str = String();
+     * for (int i = 0; i < 100; i++)
+     *     long_str.append("caf\xC3\xA9 \xE2\x98\xBA \xF0\x9F\x90\x84 ");
+     * for (auto level : { SIMD::Level::Scalar, SIMD::Level::SSE2, SIMD::Level::AVX2 }) {
+     *     SIMD::set_level(level);
+     *     assert(long_str.contains_seemingly_valid_utf8_encoded_characters());
+     *     auto broken = long_str.clone();
+     *     broken[broken.size() - 2] = 'x';
+     *     assert_not(broken.contains_seemingly_valid_utf8_encoded_characters());
+     * }
      * ```
      */
     bool contains_seemingly_valid_utf8_encoded_characters() const {
-        int index = 0;
-        char buf[5];
-        do {
-            index = next_utf8_char(index, buf);
-        } while (index > 0);
-        return index == 0;
+        return is_valid_utf8();
     }
 
     /**
-     * Returns true if the string contains multibyte
-     * UTF-8-encoded characters that seem to be valid.
-     *
-     * NOTE: This is not fool-proof. There's a lot of
-     * checks we aren't doing.
+     * Returns true if the string is valid UTF-8 and contains
+     * at least one multibyte character.
      *
      * ```
      * assert_eq(false, String("abc").contains_utf8_encoded_multibyte_characters());
      * assert_eq(true, String("🐄").contains_utf8_encoded_multibyte_characters());
      * assert_eq(false, String("\xC3").contains_utf8_encoded_multibyte_characters());
+     * assert_eq(false, String("\xE0\x80\xAF").contains_utf8_encoded_multibyte_characters());
+     *
+     * auto long_str = String();
+     * for (int i = 0; i < 100; i++)
+     *     long_str.append("plain ascii ");
+     * assert_eq(false, long_str.contains_utf8_encoded_multibyte_characters());
+     * long_str.append("\xC3\xA9");
+     * assert_eq(true, long_str.contains_utf8_encoded_multibyte_characters());
      * ```
      */
     bool contains_utf8_encoded_multibyte_characters() const {
-        int index_was = 0;
-        int index = 0;
-        char buf[5];
-        bool multibyte = false;
-        do {
-            index = next_utf8_char(index, buf);
-            if (index > index_was + 1)
-                multibyte = true;
-            index_was = index;
-        } while (index > 0);
-        return index == 0 && multibyte;
+        // valid UTF-8 with any non-ASCII byte has a multibyte character
+        return !is_ascii() && is_valid_utf8();
     }
 
     /**
@@ -1856,16 +2517,161 @@ public:
     }
 
 protected:
+    static size_t estimated_size() { return 0; }
+
+    template <typename T, typename... Args>
+    static size_t estimated_size(const T &first, const Args &...rest) {
+        return estimated_size_of(first) + estimated_size(rest...);
+    }
+
+    static size_t estimated_size_of(const String &str) { return str.m_length; }
+    static size_t estimated_size_of(const char *const str) { return str ? strlen(str) : 0; }
+    static size_t estimated_size_of(const char) { return 1; }
+
+    // numbers and anything else with an append() overload
+    template <typename T>
+    static size_t estimated_size_of(const T &) { return 16; }
+
+    // Returns the next "{}" in the given range, or nullptr.
+    static const char *find_placeholder(const char *begin, const char *const end) {
+        while (begin < end) {
+            auto brace = static_cast<const char *>(memchr(begin, '{', end - begin));
+            if (!brace)
+                return nullptr;
+            if (brace + 1 < end && brace[1] == '}')
+                return brace;
+            begin = brace + 1;
+        }
+        return nullptr;
+    }
+
+    static void format_segments(String &out, const char *begin, const char *const end) {
+        out.append(begin, end - begin);
+    }
+
+    template <typename T, typename... Args>
+    static void format_segments(String &out, const char *begin, const char *const end, const T &first, const Args &...rest) {
+        auto placeholder = find_placeholder(begin, end);
+        if (!placeholder) {
+            out.append(begin, end - begin);
+            return;
+        }
+        out.append(begin, placeholder - begin);
+        out.append(first);
+        format_segments(out, placeholder + 2, end, rest...);
+    }
+
+    template <size_t N>
+    static void format_placeholders(String &out, const FormatString<N> &fmt, size_t, const size_t offset) {
+        out.append(fmt.c_str() + offset, fmt.length() - offset);
+    }
+
+    template <size_t N, typename T, typename... Args>
+    static void format_placeholders(String &out, const FormatString<N> &fmt, const size_t index, const size_t offset, const T &first, const Args &...rest) {
+        if (index == fmt.placeholder_count()) {
+            out.append(fmt.c_str() + offset, fmt.length() - offset);
+            return;
+        }
+        const size_t position = fmt.placeholder(index);
+        out.append(fmt.c_str() + offset, position - offset);
+        out.append(first);
+        format_placeholders(out, fmt, index + 1, position + 2, rest...);
+    }
+
     void grow(const size_t new_capacity) {
         assert(new_capacity >= m_length);
         auto old_str = m_str;
-        m_str = new char[new_capacity + 1];
+        auto old_refcount = m_refcount;
+        m_str = allocate_buffer(new_capacity, m_refcount);
         if (old_str)
             memcpy(m_str, old_str, sizeof(char) * (m_capacity + 1));
         else
             m_str[0] = '\0';
-        delete[] old_str;
+        release(old_str, old_refcount);
         m_capacity = new_capacity;
+        // references into the old buffer are no longer valid
+        m_shareable = true;
+    }
+
+    // Copies of a String share its buffer until one of them is
+    // modified. Every buffer has a refcount counting the Strings
+    // that point at it. Buffers allocated here carry the count in
+    // a header just before the characters, so sharing never
+    // allocates and never touches the source String. Buffers
+    // adopted by create_and_take_ownership() get a separate empty
+    // one, which cannot sit right before them since its own
+    // terminator byte is in the way. Once operator[] has handed
+    // out a char&, the buffer is copied instead of shared, like
+    // the "leaked" strings of pre-C++11 libstdc++.
+    //
+    // Since copies that look independent may share a buffer, the
+    // count is atomic so they can be used and released from
+    // different threads. That costs a locked increment or
+    // decrement on every copy and destruction of a shared String;
+    // copying still never allocates or copies bytes.
+    using RefCount = std::atomic<size_t>;
+
+    static_assert(sizeof(RefCount) % alignof(RefCount) == 0);
+
+    // Allocates room for the given capacity plus the null
+    // terminator, behind a refcount header set to 1.
+    static char *allocate_buffer(const size_t capacity, RefCount *&refcount) {
+        auto block = new char[sizeof(RefCount) + capacity + 1];
+        refcount = new (block) RefCount { 1 };
+        return block + sizeof(RefCount);
+    }
+
+    static bool has_header(const char *str, const RefCount *refcount) {
+        return reinterpret_cast<const char *>(refcount) + sizeof(RefCount) == str;
+    }
+
+    bool is_shared() const {
+        return m_refcount && *m_refcount > 1;
+    }
+
+    void share_buffer_of(const String &other) {
+        if (!other.m_str) return;
+        m_length = other.m_length;
+        m_capacity = other.m_capacity;
+        if (!other.m_shareable) {
+            // a char& handed out by operator[] could still write to it
+            m_str = allocate_buffer(m_capacity, m_refcount);
+            memcpy(m_str, other.m_str, sizeof(char) * (m_length + 1));
+            return;
+        }
+        ++*other.m_refcount;
+        m_str = other.m_str;
+        m_refcount = other.m_refcount;
+    }
+
+    static void release(char *str, RefCount *refcount) {
+        if (!str) return;
+        if (--*refcount > 0)
+            return;
+        if (!has_header(str, refcount))
+            delete[] str;
+        refcount->~RefCount();
+        delete[] reinterpret_cast<char *>(refcount);
+    }
+
+    void release_buffer() {
+        release(m_str, m_refcount);
+        m_str = nullptr;
+        m_length = 0;
+        m_capacity = 0;
+        m_refcount = nullptr;
+        m_shareable = true;
+    }
+
+    // Gives this String its own copy of a shared buffer.
+    void detach() {
+        if (is_shared())
+            grow(m_capacity);
+    }
+
+    // Called by every method that changes the bytes in place.
+    void will_modify() {
+        detach();
     }
 
     void grow_at_least(const size_t min_capacity) {
@@ -1878,6 +2684,7 @@ protected:
     }
 
     void increment_successive_char(const char first_char_in_range, const char last_char_in_range, const char prepend_char_to_grow) {
+        will_modify();
         assert(m_length > 0);
         ssize_t index = m_length - 1;
         char last_char = m_str[index];
@@ -1894,8 +2701,226 @@ protected:
         }
     }
 
+    template <size_t>
+    friend class StringConcat;
+
+    // One operand of a StringConcat: either a String, whose
+    // buffer is shared rather than copied, or a string literal.
+    struct ConcatPiece;
+
     char *m_str { nullptr };
     size_t m_length { 0 };
     size_t m_capacity { 0 };
+    RefCount *m_refcount { nullptr };
+    bool m_shareable { true }; // false once operator[] has handed out a char&
 };
+
+struct String::ConcatPiece {
+    String str {};
+    const char *literal { nullptr };
+    size_t size { 0 };
+
+    const char *data() const { return literal ? literal : str.c_str(); }
+};
+
+/**
+ * The result of String::operator+. Each String operand is held
+ * as a copy, which only shares its buffer, and string literals
+ * are held as pointers, so building a chain like `a + b + c + d`
+ * allocates nothing. The pieces are copied into a new String,
+ * with a single allocation, when the StringConcat is converted.
+ *
+ * Because the Strings are shared rather than borrowed, a
+ * StringConcat can safely outlive its operands, even temporaries.
+ * Only char arrays are borrowed, so a local buffer must outlive
+ * a StringConcat built from it.
+ *
+ * ```
+ * auto make = []() { return String("abc"); };
+ * auto concat = make() + String("!") + "?";
+ * assert_eq(5, concat.size());
+ * String result = concat;
+ * assert_str_eq("abc!?", result);
+ * assert_str_eq("abc!?", make() + "!" + String("?"));
+ * assert_str_eq("x5", String("x") + 5);
+ * ```
+ */
+template <size_t N>
+class StringConcat {
+public:
+    StringConcat<N + 1> operator+(const String &other) const & {
+        return with(String::ConcatPiece { other, nullptr, other.size() });
+    }
+
+    StringConcat<N + 1> operator+(const String &other) && {
+        return std::move(*this).with(String::ConcatPiece { other, nullptr, other.size() });
+    }
+
+    template <size_t M>
+    StringConcat<N + 1> operator+(const char (&other)[M]) const & {
+        return with(String::ConcatPiece { {}, other, strlen(other) });
+    }
+
+    template <size_t M>
+    StringConcat<N + 1> operator+(const char (&other)[M]) && {
+        return std::move(*this).with(String::ConcatPiece { {}, other, strlen(other) });
+    }
+
+    /**
+     * Returns the total number of bytes in the pieces.
+     *
+     * ```
+     * auto str = String("foo");
+     * assert_eq(9, (str + str + str).size());
+     * assert_eq(6, (str + "bar").length());
+     * assert((String() + "").is_empty());
+     * ```
+     */
+    size_t size() const {
+        size_t total = 0;
+        for (size_t i = 0; i < N; i++)
+            total += m_pieces[i].size;
+        return total;
+    }
+
+    size_t length() const { return size(); }
+    bool is_empty() const { return size() == 0; }
+
+    /**
+     * Copies the pieces into a new String, allocating once.
+     *
+     * ```
+     * auto str = String("foo");
+     * String result = str + "bar" + str;
+     * assert_str_eq("foobarfoo", result);
+     * assert_eq(9, result.size());
+     *
+     * result = String() + String();
+     * assert_str_eq("", result);
+     * ```
+     */
+    String to_string() const {
+        const size_t length = size();
+        String result;
+        if (length == 0)
+            return result;
+        auto buf = result.m_str = String::allocate_buffer(length, result.m_refcount);
+        for (size_t i = 0; i < N; i++) {
+            memcpy(buf, m_pieces[i].data(), m_pieces[i].size);
+            buf += m_pieces[i].size;
+        }
+        *buf = '\0';
+        result.m_length = result.m_capacity = length;
+        return result;
+    }
+
+    operator String() const { return to_string(); }
+
+    String clone() const { return to_string(); }
+
+    /**
+     * Copies the pieces into a single String held by this
+     * StringConcat and returns its bytes, so that code like
+     * `(a + b).c_str()` keeps working.
+     *
+     * ```
+     * auto str = String("foo");
+     * assert_eq(0, strcmp("foobar", (str + "bar").c_str()));
+     * auto concat = str + str;
+     * auto c_str = concat.c_str();
+     * assert_eq(c_str, concat.c_str());
+     * ```
+     */
+    const char *c_str() {
+        bool flat = !m_pieces[0].literal;
+        for (size_t i = 1; i < N && flat; i++)
+            flat = m_pieces[i].size == 0;
+        if (!flat) {
+            const size_t length = size();
+            m_pieces[0] = String::ConcatPiece { to_string(), nullptr, length };
+            for (size_t i = 1; i < N; i++)
+                m_pieces[i] = String::ConcatPiece {};
+        }
+        return m_pieces[0].str.c_str();
+    }
+
+    /**
+     * Compares the pieces to the given String or C string
+     * without building the result.
+     *
+     * ```
+     * auto str = String("foo");
+     * assert(str + "bar" == String("foobar"));
+     * assert(str + "bar" != String("foobaz"));
+     * assert(str + "bar" == "foobar");
+     * assert(str + "bar" != "foo");
+     * ```
+     */
+    bool operator==(const String &other) const {
+        return equals(other.c_str(), other.size());
+    }
+
+    bool operator!=(const String &other) const {
+        return !operator==(other);
+    }
+
+    bool operator==(const char *const other) const {
+        assert(other);
+        return equals(other, strlen(other));
+    }
+
+    bool operator!=(const char *const other) const {
+        return !operator==(other);
+    }
+
+private:
+    template <size_t>
+    friend class StringConcat;
+    friend class String;
+
+    StringConcat() { }
+
+    StringConcat<N + 1> with(String::ConcatPiece &&piece) const & {
+        StringConcat<N + 1> result;
+        for (size_t i = 0; i < N; i++)
+            result.m_pieces[i] = m_pieces[i];
+        result.m_pieces[N] = std::move(piece);
+        return result;
+    }
+
+    StringConcat<N + 1> with(String::ConcatPiece &&piece) && {
+        StringConcat<N + 1> result;
+        for (size_t i = 0; i < N; i++)
+            result.m_pieces[i] = std::move(m_pieces[i]);
+        result.m_pieces[N] = std::move(piece);
+        return result;
+    }
+
+    bool equals(const char *str, size_t length) const {
+        if (size() != length)
+            return false;
+        for (size_t i = 0; i < N; i++) {
+            if (memcmp(m_pieces[i].data(), str, m_pieces[i].size) != 0)
+                return false;
+            str += m_pieces[i].size;
+        }
+        return true;
+    }
+
+    String::ConcatPiece m_pieces[N];
+};
+
+inline StringConcat<2> String::operator+(const String &other) const {
+    StringConcat<1> concat;
+    concat.m_pieces[0] = ConcatPiece { *this, nullptr, m_length };
+    return std::move(concat) + other;
+}
+
+template <size_t N>
+StringConcat<2> String::operator+(const char (&other)[N]) const {
+    StringConcat<1> concat;
+    concat.m_pieces[0] = ConcatPiece { *this, nullptr, m_length };
+    return std::move(concat) + other;
+}
+
 }
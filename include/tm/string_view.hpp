@@ -1,10 +1,52 @@
 #pragma once
 
 #include "string.hpp"
+#include "tm/simd.hpp"
+#include "tm/span.hpp"
 #include <assert.h>
 
 namespace TM {
 
+/**
+ * A non-owning view of a range of bytes. The bytes can live in a
+ * String, a C string, a Span or any other buffer; the view holds
+ * only a pointer and a length, so it must not outlive the memory
+ * it points at.
+ *
+ * ```
+ * const char *buf = "GET /index.html HTTP/1.1";
+ * auto method = StringView(buf, 3);
+ * auto path = StringView(buf + 4, 11);
+ * assert(method == "GET");
+ * assert(path == "/index.html");
+ * ```
+ *
+ * A view into a String is invalidated by any change to that
+ * String, not only by the ones that grow it. Copies of a String
+ * share one buffer, so even the non-const String::operator[] can
+ * move the String to a private buffer, leaving the view reading
+ * the copy's bytes instead.
+ *
+ * ```
+ * auto str = String("foo");
+ * auto copy = str;
+ * auto view = StringView(str);
+ * str[0] = 'g';
+ * assert_str_eq("goo", str);
+ * assert_str_eq("foo", view); // stale: it still points at copy's buffer
+ * ```
+ *
+ * Reading a view after its String has reallocated is a use
+ * after free.
+ *
+ * ```should_abort
+ * auto str = String("foo");
+ * auto view = StringView(str);
+ * for (int i = 0; i < 100; i++)
+ *     str.append("bar");
+ * assert_eq('f', view[0]);
+ * ```
+ */
 class StringView {
 public:
     /**
@@ -28,9 +70,76 @@ public:
      * ```
      */
     explicit StringView(const String *string)
-        : m_string { string }
+        : m_data { string->c_str() }
         , m_length { string->length() } { }
 
+    /**
+     * Constructs a StringView pointing at the given String.
+     *
+     * ```
+     * auto str = String("foo");
+     * auto view = StringView(str);
+     * assert_eq(3, view.size());
+     * assert_eq(str.c_str(), view.data());
+     * ```
+     */
+    explicit StringView(const String &string)
+        : StringView { &string } { }
+
+    /**
+     * Constructs a StringView over a null-terminated C string,
+     * not including the terminator.
+     *
+     * ```
+     * auto view = StringView("foo");
+     * assert_eq(3, view.size());
+     * assert_str_eq("foo", view);
+     * ```
+     *
+     * This constructor aborts if the pointer is null.
+     *
+     * ```should_abort
+     * const char *str = nullptr;
+     * StringView { str };
+     * ```
+     */
+    explicit StringView(const char *str)
+        : m_data { str } {
+        assert(str);
+        m_length = strlen(str);
+    }
+
+    /**
+     * Constructs a StringView over the given number of bytes,
+     * which need not be null-terminated.
+     *
+     * ```
+     * char buf[] = { 'f', 'o', 'o', 'b', 'a', 'r' };
+     * auto view = StringView(buf, 3);
+     * assert_str_eq("foo", view);
+     * auto view2 = StringView("foo\0bar", 7);
+     * assert_eq(7, view2.size());
+     * ```
+     */
+    explicit StringView(const char *str, size_t length)
+        : m_data { str }
+        , m_length { length } {
+        assert(str || length == 0);
+    }
+
+    /**
+     * Constructs a StringView over the bytes of a Span.
+     *
+     * ```
+     * const char list[] = { 'a', 'b', 'c', 'd' };
+     * auto view = StringView(Span<char> { list, 3 });
+     * assert_str_eq("abc", view);
+     * ```
+     */
+    explicit StringView(const Span<char> &span)
+        : m_data { &span[0] }
+        , m_length { span.size() } { }
+
     /**
      * Constructs a StringView with given offset.
      *
@@ -51,12 +160,21 @@ public:
      * auto view = StringView(&str, 4);
      * (void)view;
      * ```
+     *
+     * The check comes before the pointer is offset, so even a
+     * huge offset aborts cleanly.
+     *
+     * ```should_abort
+     * auto str = String("foo");
+     * auto view = StringView(&str, SIZE_MAX);
+     * (void)view;
+     * ```
      */
     explicit StringView(const String *string, size_t offset)
-        : m_string { string }
-        , m_offset { offset }
-        , m_length { string->length() - offset } {
+        : m_offset { offset } {
         assert(offset <= string->length());
+        m_data = string->c_str() + offset;
+        m_length = string->length() - offset;
     }
 
     /**
@@ -77,11 +195,11 @@ public:
      * ```
      */
     explicit StringView(const String *string, size_t offset, size_t length)
-        : m_string { string }
-        , m_offset { offset }
+        : m_offset { offset }
         , m_length { length } {
         assert(offset <= string->length());
         assert(length <= string->length() - offset);
+        m_data = string->c_str() + offset;
     }
 
     /**
@@ -111,12 +229,14 @@ public:
     StringView &operator=(const StringView &other) = default;
 
     /**
-     * Returns the offset into the String.
+     * Returns the offset into the String the view was constructed
+     * from, or zero for views over other memory.
      *
      * ```
      * auto str = String("foo-bar-baz");
      * auto view = StringView(&str, 4);
      * assert_eq(4, view.offset());
+     * assert_eq(0, StringView("foo").offset());
      * ```
      */
     size_t offset() const { return m_offset; }
@@ -164,16 +284,11 @@ public:
      * ```
      */
     bool operator==(const char *other) const {
-        if (!other && !m_string)
-            return true;
-        auto other_length = strlen(other);
-        if (!m_string && other_length == 0)
-            return true;
-        if (!m_string)
+        if (!other)
+            return m_length == 0;
+        if (m_length != strlen(other))
             return false;
-        if (m_length != other_length)
-            return false;
-        return memcmp(m_string->c_str() + m_offset, other, sizeof(char) * m_length) == 0;
+        return m_length == 0 || memcmp(m_data, other, sizeof(char) * m_length) == 0;
     }
 
     bool operator!=(const char *other) const {
@@ -194,18 +309,18 @@ public:
      * assert_not(view1 == view2);
      *
      * assert(StringView() == StringView());
+     *
+     * auto str3 = String("foo-foo");
+     * assert(StringView(&str3, 0, 3) == StringView(&str3, 4, 3));
+     * assert(StringView(&str3, 4, 3) == StringView("foo"));
      * ```
      */
     bool operator==(const StringView &other) const {
-        if (m_string == other.m_string) // shortcut
-            return m_offset == other.m_offset && m_length == other.m_length;
-        if (!m_string && other.m_length == 0)
-            return true;
-        if (!m_string)
-            return false;
         if (m_length != other.m_length)
             return false;
-        return memcmp(m_string->c_str() + m_offset, other.m_string->c_str(), sizeof(char) * m_length) == 0;
+        if (m_data == other.m_data || m_length == 0) // shortcut
+            return true;
+        return memcmp(m_data, other.m_data, sizeof(char) * m_length) == 0;
     }
 
     bool operator!=(const StringView &other) const {
@@ -241,9 +356,9 @@ public:
      * ```
      */
     String to_string() const {
-        if (!m_string)
+        if (m_length == 0)
             return String();
-        return String { m_string->c_str() + m_offset, m_length };
+        return String { m_data, m_length };
     }
 
     /**
@@ -276,8 +391,8 @@ public:
      * ```
      */
     char at(size_t index) const {
-        assert(m_string);
-        return m_string->at(m_offset + index);
+        assert(index < m_length);
+        return m_data[index];
     }
 
     /**
@@ -293,10 +408,24 @@ public:
      * index is within the bounds of the string data!
      */
     char operator[](size_t index) const {
-        assert(m_string);
-        return (*m_string)[m_offset + index];
+        assert(m_data);
+        return m_data[index];
     }
 
+    /**
+     * Returns a pointer to the first byte of the view, or null
+     * for a default-constructed view. The bytes are generally
+     * not null-terminated at the end of the view.
+     *
+     * ```
+     * auto str = String("foo-bar-baz");
+     * auto view = StringView(&str, 4, 3);
+     * assert_eq(str.c_str() + 4, view.data());
+     * assert_eq(nullptr, StringView().data());
+     * ```
+     */
+    const char *data() const { return m_data; }
+
     /**
      * Returns a pointer to the underlying C string data.
      * This method should be used with care, because it does not
@@ -311,8 +440,8 @@ public:
      * ```
      */
     const char *dangerous_pointer_to_underlying_data() const {
-        assert(m_string);
-        return (*m_string).c_str() + m_offset;
+        assert(m_data);
+        return m_data;
     }
 
     /**
@@ -328,8 +457,552 @@ public:
      */
     bool is_empty() const { return m_length == 0; }
 
+    /**
+     * Returns a view of the given range of this one. No bytes
+     * are copied.
+     *
+     * ```
+     * auto view = StringView("foo-bar-baz");
+     * auto sub = view.substring(4, 3);
+     * assert_str_eq("bar", sub);
+     * assert_eq(view.data() + 4, sub.data());
+     * assert_str_eq("", view.substring(11, 0));
+     * ```
+     *
+     * This method aborts if the range extends past the end.
+     *
+     * ```should_abort
+     * StringView("abc").substring(1, 3);
+     * ```
+     */
+    StringView substring(size_t start, size_t length) const {
+        assert(start <= m_length);
+        assert(length <= m_length - start);
+        return StringView { m_data + start, length };
+    }
+
+    /**
+     * Returns a view from the given start index to the end.
+     *
+     * ```
+     * auto view = StringView("foo-bar");
+     * assert_str_eq("bar", view.substring(4));
+     * ```
+     */
+    StringView substring(size_t start) const {
+        assert(start <= m_length);
+        return substring(start, m_length - start);
+    }
+
+    /**
+     * Finds the given bytes inside this view and returns their
+     * starting index, or -1 if they are not found.
+     *
+     * ```
+     * auto view = StringView("hello hello world");
+     * assert_eq(12, view.find(StringView("world")));
+     * assert_eq(-1, view.find(StringView("worlds")));
+     * assert_eq(-1, view.find(StringView("")));
+     * assert_eq(-1, StringView().find(StringView("a")));
+     * ```
+     */
+    ssize_t find(StringView needle) const {
+        return find_from(needle, 0);
+    }
+
+    /**
+     * Finds the given character inside this view and returns
+     * its index, or -1 if it is not found.
+     *
+     * ```
+     * auto str = String("hello world");
+     * auto view = StringView(&str, 6);
+     * assert_eq(3, view.find('l'));
+     * assert_eq(-1, view.find('h'));
+     * ```
+     */
+    ssize_t find(char c) const {
+        return find_from(c, 0);
+    }
+
+    /**
+     * Finds the given bytes inside this view, starting the search
+     * at the given offset, and returns their starting index.
+     *
+     * ```
+     * auto view = StringView("abcabcabc");
+     * assert_eq(4, view.find_from(StringView("bc"), 2));
+     * assert_eq(-1, view.find_from(StringView("bc"), 8));
+     * assert_eq(-1, view.find_from(StringView("bc"), 100));
+     * ```
+     */
+    ssize_t find_from(StringView needle, size_t offset) const {
+        if (offset >= m_length)
+            return -1;
+        const auto index = SIMD::find_substring(m_data + offset, m_length - offset, needle.m_data, needle.m_length);
+        return index == -1 ? -1 : index + offset;
+    }
+
+    /**
+     * Finds the given character inside this view, starting the
+     * search at the given offset, and returns its index.
+     *
+     * ```
+     * auto view = StringView("hello world");
+     * assert_eq(9, view.find_from('l', 4));
+     * assert_eq(-1, view.find_from('l', 10));
+     * ```
+     */
+    ssize_t find_from(char c, size_t offset) const {
+        if (offset >= m_length)
+            return -1;
+        const auto index = SIMD::find(m_data + offset, m_length - offset, c);
+        return index == -1 ? -1 : index + offset;
+    }
+
+    /**
+     * Finds the last occurrence of the given bytes inside this
+     * view and returns its starting index, or -1.
+     *
+     * ```
+     * auto view = StringView("hello hello world");
+     * assert_eq(6, view.rfind(StringView("hello")));
+     * assert_eq(-1, view.rfind(StringView("")));
+     * ```
+     */
+    ssize_t rfind(StringView needle) const {
+        return SIMD::rfind_substring(m_data, m_length, needle.m_data, needle.m_length);
+    }
+
+    /**
+     * Finds the last occurrence of the given character inside
+     * this view and returns its index, or -1.
+     *
+     * ```
+     * auto str = String("hello world");
+     * auto view = StringView(&str, 0, 5);
+     * assert_eq(3, view.rfind('l'));
+     * assert_eq(-1, view.rfind('w'));
+     * ```
+     */
+    ssize_t rfind(char c) const {
+        return SIMD::rfind_substring(m_data, m_length, &c, 1);
+    }
+
+    /**
+     * Returns true if this view starts with the given bytes.
+     *
+     * ```
+     * auto view = StringView("foo-bar");
+     * assert(view.begins_with(StringView("foo")));
+     * assert(view.begins_with("foo-"));
+     * assert(view.begins_with('f'));
+     * assert(view.begins_with(""));
+     * assert_not(view.begins_with("bar"));
+     * assert_not(StringView("fo").begins_with("foo"));
+     * assert_not(StringView().begins_with('f'));
+     * ```
+     */
+    bool begins_with(StringView needle) const {
+        if (needle.m_length > m_length)
+            return false;
+        return needle.m_length == 0 || memcmp(m_data, needle.m_data, needle.m_length) == 0;
+    }
+
+    bool begins_with(const char *needle) const {
+        return begins_with(StringView { needle });
+    }
+
+    bool begins_with(char c) const {
+        return m_length > 0 && m_data[0] == c;
+    }
+
+    /**
+     * Returns true if this view ends with the given bytes.
+     *
+     * ```
+     * auto view = StringView("foo-bar");
+     * assert(view.ends_with(StringView("bar")));
+     * assert(view.ends_with("-bar"));
+     * assert(view.ends_with('r'));
+     * assert(view.ends_with(""));
+     * assert_not(view.ends_with("foo"));
+     * assert_not(StringView("ar").ends_with("bar"));
+     * assert_not(StringView().ends_with('r'));
+     * ```
+     */
+    bool ends_with(StringView needle) const {
+        if (needle.m_length > m_length)
+            return false;
+        return needle.m_length == 0 || memcmp(m_data + m_length - needle.m_length, needle.m_data, needle.m_length) == 0;
+    }
+
+    bool ends_with(const char *needle) const {
+        return ends_with(StringView { needle });
+    }
+
+    bool ends_with(char c) const {
+        return m_length > 0 && m_data[m_length - 1] == c;
+    }
+
+    /**
+     * Returns -1, 0, or 1 by comparing the bytes of this view to
+     * the given one, like String::cmp.
+     *
+     * ```
+     * auto str = String("abcdef");
+     * assert_eq(0, StringView(&str, 0, 3).cmp(StringView("abc")));
+     * assert_eq(-1, StringView(&str, 0, 3).cmp(StringView(&str, 3, 3)));
+     * assert_eq(1, StringView(&str, 3, 3).cmp(StringView(&str, 0, 3)));
+     * assert_eq(-1, StringView(&str, 0, 3).cmp(StringView(&str)));
+     * assert_eq(1, StringView(&str).cmp(StringView()));
+     * assert_eq(1, StringView("\xff").cmp(StringView("a")));
+     * ```
+     */
+    int cmp(StringView other) const {
+        const size_t common_length = std::min(m_length, other.m_length);
+        const int result = common_length == 0 ? 0 : memcmp(m_data, other.m_data, common_length);
+        if (result != 0)
+            return result < 0 ? -1 : 1;
+        if (m_length == other.m_length)
+            return 0;
+        return m_length < other.m_length ? -1 : 1;
+    }
+
+    bool operator<(StringView other) const { return cmp(other) < 0; }
+
+    /**
+     * Returns the same hash as String::djb2_hash() for equal
+     * contents, so views and Strings can stand in for each other
+     * as Hashmap keys.
+     *
+     * ```
+     * auto str = String("foo.bar");
+     * assert_eq(String("bar").djb2_hash(), StringView(&str, 4).djb2_hash());
+     * assert_eq(String().djb2_hash(), StringView().djb2_hash());
+     * ```
+     */
+    size_t djb2_hash() const {
+        size_t hash = 5381;
+        int c;
+        for (size_t i = 0; i < m_length; ++i) {
+            c = m_data[i];
+            hash = ((hash << 5) + hash) + c;
+        }
+        return hash;
+    }
+
+    /**
+     * Returns a view without leading and trailing ASCII whitespace.
+     *
+     * ```
+     * auto view = StringView(" \t foo bar \r\n");
+     * assert_str_eq("foo bar", view.strip());
+     * assert_str_eq("foo bar \r\n", view.lstrip());
+     * assert_str_eq(" \t foo bar", view.rstrip());
+     * assert(StringView("  ").strip().is_empty());
+     * assert(StringView().strip().is_empty());
+     * ```
+     */
+    StringView strip() const {
+        return lstrip().rstrip();
+    }
+
+    StringView lstrip() const {
+        const ssize_t start = SIMD::index_of_first_not_ascii_whitespace(m_data, m_length);
+        if (start == -1)
+            return substring(m_length);
+        return substring(start);
+    }
+
+    StringView rstrip() const {
+        return substring(0, SIMD::size_without_trailing_ascii_whitespace(m_data, m_length));
+    }
+
+    /**
+     * Parses a decimal integer from the start of this view,
+     * without copying it. If consumed is given, it is set to
+     * the number of bytes that were parsed.
+     * See NumberParser::parse_int64.
+     *
+     * ```
+     * auto str = String("x=-42;");
+     * auto view = StringView(&str, 2);
+     * size_t consumed = 0;
+     * assert_eq(-42, view.to_int64(&consumed).value());
+     * assert_eq(3, consumed);
+     * assert_not(StringView(&str, 2, 1).to_int64());
+     * assert_not(StringView().to_int64());
+     * ```
+     */
+    Optional<int64_t> to_int64(size_t *consumed = nullptr) const {
+        return NumberParser::parse_int64(data(), m_length, consumed);
+    }
+
+    /**
+     * Parses an unsigned decimal integer from the start of this
+     * view. See NumberParser::parse_uint64.
+     *
+     * ```
+     * auto str = String("1234");
+     * assert_eq(12, StringView(&str, 0, 2).to_uint64().value());
+     * ```
+     */
+    Optional<uint64_t> to_uint64(size_t *consumed = nullptr) const {
+        return NumberParser::parse_uint64(data(), m_length, consumed);
+    }
+
+    /**
+     * Parses a decimal floating-point number from the start of
+     * this view, independent of locale. The view does not need
+     * to be followed by a null terminator.
+     * See NumberParser::parse_double.
+     *
+     * ```
+     * auto str = String("[1.5,2.25e2]");
+     * assert_eq(1.5, StringView(&str, 1, 3).to_double().value());
+     * assert_eq(225.0, StringView(&str, 5, 6).to_double().value());
+     * assert_eq(2.2, StringView(&str, 5, 3).to_double().value());
+     * ```
+     */
+    Optional<double> to_double(size_t *consumed = nullptr) const {
+        return NumberParser::parse_double(data(), m_length, consumed);
+    }
+
+    enum class SplitMode {
+        Char,
+        Separator,
+        Lines,
+        Whitespace,
+    };
+
+    // Yields the pieces of a view one at a time, finding each
+    // delimiter with SIMD. Pieces are views into the original
+    // bytes, so iterating never allocates.
+    class SplitIterator {
+    public:
+        SplitIterator() { }
+
+        SplitIterator(SplitMode mode, const char *data, size_t size, char separator_char, const char *separator, size_t separator_size)
+            : m_mode { mode }
+            , m_rest { data }
+            , m_end { data + size }
+            , m_separator_char { separator_char }
+            , m_separator { separator }
+            , m_separator_size { separator_size }
+            , m_has_rest { true }
+            , m_done { false } {
+            advance();
+        }
+
+        StringView operator*() const {
+            return StringView { m_piece, m_piece_size };
+        }
+
+        SplitIterator &operator++() {
+            advance();
+            return *this;
+        }
+
+        friend bool operator==(const SplitIterator &i1, const SplitIterator &i2) {
+            if (i1.m_done || i2.m_done)
+                return i1.m_done == i2.m_done;
+            return i1.m_piece == i2.m_piece && i1.m_piece_size == i2.m_piece_size;
+        }
+
+        friend bool operator!=(const SplitIterator &i1, const SplitIterator &i2) {
+            return !(i1 == i2);
+        }
+
+    private:
+        void advance() {
+            if (!m_has_rest) {
+                m_done = true;
+                return;
+            }
+            const size_t remaining = m_end - m_rest;
+            ssize_t index;
+            size_t skip = m_separator_size;
+            switch (m_mode) {
+            case SplitMode::Char:
+                index = SIMD::find(m_rest, remaining, m_separator_char);
+                skip = 1;
+                break;
+            case SplitMode::Separator:
+                index = SIMD::find_substring(m_rest, remaining, m_separator, m_separator_size);
+                break;
+            case SplitMode::Lines:
+                if (remaining == 0) {
+                    m_done = true;
+                    return;
+                }
+                index = SIMD::find(m_rest, remaining, '\n');
+                skip = 1;
+                break;
+            case SplitMode::Whitespace: {
+                const ssize_t start = SIMD::index_of_first_not_ascii_whitespace(m_rest, remaining);
+                if (start == -1) {
+                    m_done = true;
+                    return;
+                }
+                m_rest += start;
+                index = SIMD::find_ascii_whitespace(m_rest, remaining - start);
+                skip = 1;
+                break;
+            }
+            }
+            m_piece = m_rest;
+            if (index == -1) {
+                m_piece_size = m_end - m_rest;
+                m_has_rest = false;
+            } else {
+                m_piece_size = index;
+                m_rest += index + skip;
+            }
+            if (m_mode == SplitMode::Lines && m_piece_size > 0 && m_piece[m_piece_size - 1] == '\r')
+                m_piece_size--;
+        }
+
+        SplitMode m_mode { SplitMode::Char };
+        const char *m_rest { nullptr };
+        const char *m_end { nullptr };
+        char m_separator_char { 0 };
+        const char *m_separator { nullptr };
+        size_t m_separator_size { 0 };
+        const char *m_piece { nullptr };
+        size_t m_piece_size { 0 };
+        bool m_has_rest { false };
+        bool m_done { true };
+    };
+
+    class Split {
+    public:
+        Split(SplitMode mode, const char *data, size_t size, char separator_char = 0, const char *separator = nullptr, size_t separator_size = 0)
+            : m_mode { mode }
+            , m_data { data }
+            , m_size { size }
+            , m_separator_char { separator_char }
+            , m_separator { separator }
+            , m_separator_size { separator_size } { }
+
+        SplitIterator begin() const {
+            return SplitIterator { m_mode, m_data, m_size, m_separator_char, m_separator, m_separator_size };
+        }
+
+        SplitIterator end() const { return SplitIterator {}; }
+
+    private:
+        SplitMode m_mode;
+        const char *m_data;
+        size_t m_size;
+        char m_separator_char;
+        const char *m_separator;
+        size_t m_separator_size;
+    };
+
+    /**
+     * Returns a lazy range over the pieces of this view between
+     * occurrences of the given character. Empty pieces are kept,
+     * so n separators always yield n + 1 pieces.
+     *
+     * ```
+     * auto view = StringView("a,b,,c,");
+     * auto pieces = Vector<String>();
+     * for (auto piece : view.split(','))
+     *     pieces.push(piece.to_string());
+     * assert_eq(5, pieces.size());
+     * assert_str_eq("a", pieces[0]);
+     * assert_str_eq("b", pieces[1]);
+     * assert_str_eq("", pieces[2]);
+     * assert_str_eq("c", pieces[3]);
+     * assert_str_eq("", pieces[4]);
+     *
+     * size_t count = 0;
+     * for (auto piece : StringView().split(',')) {
+     *     assert(piece.is_empty());
+     *     count++;
+     * }
+     * assert_eq(1, count);
+     * ```
+     */
+    Split split(char separator) const {
+        return Split { SplitMode::Char, m_data, m_length, separator };
+    }
+
+    /**
+     * Returns a lazy range over the pieces of this view between
+     * occurrences of the given separator. The separator must
+     * not be empty, and must outlive the range.
+     *
+     * ```
+     * auto str = String("key => value => other");
+     * auto pieces = Vector<String>();
+     * for (auto piece : StringView(str).split(StringView(" => ")))
+     *     pieces.push(piece.to_string());
+     * assert_eq(3, pieces.size());
+     * assert_str_eq("key", pieces[0]);
+     * assert_str_eq("value", pieces[1]);
+     * assert_str_eq("other", pieces[2]);
+     * ```
+     *
+     * ```should_abort
+     * StringView("abc").split(StringView(""));
+     * ```
+     */
+    Split split(StringView separator) const {
+        assert(separator.size() > 0);
+        return Split { SplitMode::Separator, m_data, m_length, 0, separator.m_data, separator.m_length };
+    }
+
+    /**
+     * Returns a lazy range over the lines of this view, without
+     * their "\n" or "\r\n" terminators. A final line terminator
+     * does not produce an extra empty line.
+     *
+     * ```
+     * auto view = StringView("one\r\ntwo\n\nthree\n");
+     * auto lines = Vector<String>();
+     * for (auto line : view.lines())
+     *     lines.push(line.to_string());
+     * assert_eq(4, lines.size());
+     * assert_str_eq("one", lines[0]);
+     * assert_str_eq("two", lines[1]);
+     * assert_str_eq("", lines[2]);
+     * assert_str_eq("three", lines[3]);
+     *
+     * auto empty = StringView("");
+     * assert(empty.lines().begin() == empty.lines().end());
+     * ```
+     */
+    Split lines() const {
+        return Split { SplitMode::Lines, m_data, m_length };
+    }
+
+    /**
+     * Returns a lazy range over the runs of non-whitespace
+     * bytes in this view. Leading, trailing and repeated ASCII
+     * whitespace never produces empty pieces.
+     *
+     * ```
+     * auto view = StringView("  GET\t/index.html   HTTP/1.1\r\n");
+     * auto tokens = Vector<String>();
+     * for (auto token : view.split_whitespace())
+     *     tokens.push(token.to_string());
+     * assert_eq(3, tokens.size());
+     * assert_str_eq("GET", tokens[0]);
+     * assert_str_eq("/index.html", tokens[1]);
+     * assert_str_eq("HTTP/1.1", tokens[2]);
+     *
+     * auto blank = StringView(" \t\n ");
+     * assert(blank.split_whitespace().begin() == blank.split_whitespace().end());
+     * ```
+     */
+    Split split_whitespace() const {
+        return Split { SplitMode::Whitespace, m_data, m_length };
+    }
+
 private:
-    const String *m_string { nullptr };
+    const char *m_data { nullptr };
     size_t m_offset { 0 };
     size_t m_length { 0 };
 };
@@ -0,0 +1,323 @@
+#pragma once
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "tm/hashmap.hpp"
+#include "tm/optional.hpp"
+#include "tm/string.hpp"
+#include "tm/string_view.hpp"
+#include "tm/vector.hpp"
+
+namespace TM {
+
+/**
+ * Interns strings, mapping each distinct byte sequence to a small
+ * integer id. Identical contents always get the same id, so two
+ * interned strings can be compared or hashed as a single word.
+ *
+ * The bytes are copied once into arena chunks that are never
+ * reallocated, which keeps the pointer returned by c_str() stable
+ * for the lifetime of the table.
+ *
+ * ```
+ * auto table = SymbolTable();
+ * auto foo = table.intern("foo");
+ * auto bar = table.intern(String("bar"));
+ * assert(foo != bar);
+ * assert_eq(foo, table.intern("foo"));
+ * assert_eq(2, table.size());
+ * assert_str_eq("bar", table.to_string(bar));
+ * ```
+ */
+class SymbolTable {
+public:
+    using Id = uint32_t;
+
+    static constexpr size_t CHUNK_SIZE = 4096;
+
+    // Strings longer than this get an allocation of their own,
+    // so starting a new chunk never wastes more than this much
+    // of the previous one.
+    static constexpr size_t MAX_CHUNKED_LENGTH = CHUNK_SIZE / 4;
+
+    SymbolTable()
+        : m_map { &SymbolTable::hash_key, &SymbolTable::compare_key } { }
+
+    SymbolTable(const SymbolTable &) = delete;
+    SymbolTable &operator=(const SymbolTable &) = delete;
+
+    ~SymbolTable() {
+        for (auto chunk : m_chunks)
+            delete[] chunk;
+    }
+
+    /**
+     * Returns the id for the given bytes, copying them into
+     * the table the first time they are seen.
+     *
+     * ```
+     * auto table = SymbolTable();
+     * auto id = table.intern("foo\0bar", 7);
+     * assert_eq(id, table.intern("foo\0bar", 7));
+     * assert(id != table.intern("foo", 3));
+     * assert_eq(7, table.length(id));
+     * ```
+     *
+     * Long strings are stored on their own, so they do not use
+     * up the current chunk.
+     *
+     * ```
+     * auto table = SymbolTable();
+     * auto foo = table.intern("foo");
+     * auto long_id = table.intern(String(SymbolTable::CHUNK_SIZE * 2, 'x'));
+     * auto bar = table.intern("bar");
+     * assert_eq(table.c_str(foo) + 4, table.c_str(bar));
+     * assert_eq(SymbolTable::CHUNK_SIZE * 2, strlen(table.c_str(long_id)));
+     * ```
+     */
+    Id intern(const char *str, size_t length) {
+        Key key { str, length };
+        auto hash = hash_key(key);
+        auto item = m_map.find_item(key, hash);
+        if (item)
+            return item->value;
+
+        assert(m_symbols.size() < UINT32_MAX);
+        auto id = static_cast<Id>(m_symbols.size());
+        Key stored { store(str, length), length };
+        m_symbols.push(stored);
+        m_map.put(stored, id);
+        return id;
+    }
+
+    /**
+     * Returns the id for the given C string.
+     *
+     * ```
+     * auto table = SymbolTable();
+     * assert_eq(0, table.intern("foo"));
+     * assert_eq(1, table.intern("bar"));
+     * assert_eq(0, table.intern("foo"));
+     * ```
+     */
+    Id intern(const char *str) {
+        assert(str);
+        return intern(str, strlen(str));
+    }
+
+    /**
+     * Returns the id for the contents of the given String.
+     *
+     * ```
+     * auto table = SymbolTable();
+     * auto str = String("foo");
+     * assert_eq(table.intern("foo"), table.intern(str));
+     * ```
+     */
+    Id intern(const String &str) {
+        return intern(str.c_str(), str.length());
+    }
+
+    /**
+     * Returns the id for the contents of the given StringView.
+     * The view is looked up in place; nothing is copied unless
+     * the contents are new to the table.
+     *
+     * ```
+     * auto table = SymbolTable();
+     * auto str = String("foo.bar");
+     * auto id = table.intern(StringView(&str, 4, 3));
+     * assert_eq(id, table.intern("bar"));
+     * assert_eq(table.intern(""), table.intern(StringView()));
+     * ```
+     */
+    Id intern(StringView view) {
+        if (view.is_empty())
+            return intern("", 0);
+        return intern(view.dangerous_pointer_to_underlying_data(), view.size());
+    }
+
+    /**
+     * Returns the id for the given bytes if they have already
+     * been interned, without adding them to the table.
+     *
+     * ```
+     * auto table = SymbolTable();
+     * auto id = table.intern("foo");
+     * assert_eq(id, table.find("foo", 3).value());
+     * assert_not(table.find("bar", 3));
+     * assert_eq(1, table.size());
+     * ```
+     */
+    Optional<Id> find(const char *str, size_t length) const {
+        Key key { str, length };
+        auto item = m_map.find_item(key, hash_key(key));
+        if (!item)
+            return {};
+        return item->value;
+    }
+
+    /**
+     * Returns the id for the given C string if it has already
+     * been interned.
+     *
+     * ```
+     * auto table = SymbolTable();
+     * table.intern("foo");
+     * assert(table.find("foo"));
+     * assert_not(table.find("fo"));
+     * ```
+     */
+    Optional<Id> find(const char *str) const {
+        assert(str);
+        return find(str, strlen(str));
+    }
+
+    /**
+     * Returns the id for the contents of the given String if
+     * they have already been interned.
+     *
+     * ```
+     * auto table = SymbolTable();
+     * table.intern("foo");
+     * assert(table.find(String("foo")));
+     * assert_not(table.find(String("bar")));
+     * ```
+     */
+    Optional<Id> find(const String &str) const {
+        return find(str.c_str(), str.length());
+    }
+
+    /**
+     * Returns the id for the contents of the given StringView if
+     * they have already been interned.
+     *
+     * ```
+     * auto table = SymbolTable();
+     * table.intern("bar");
+     * auto str = String("foo.bar");
+     * assert(table.find(StringView(&str, 4, 3)));
+     * assert_not(table.find(StringView(&str, 0, 3)));
+     * ```
+     */
+    Optional<Id> find(StringView view) const {
+        if (view.is_empty())
+            return find("", 0);
+        return find(view.dangerous_pointer_to_underlying_data(), view.size());
+    }
+
+    /**
+     * Returns a null-terminated pointer to the interned bytes.
+     * The pointer stays valid for the lifetime of the table.
+     *
+     * ```
+     * auto table = SymbolTable();
+     * auto id = table.intern("foo");
+     * auto ptr = table.c_str(id);
+     * for (int i = 0; i < 1000; i++)
+     *     table.intern(String(i));
+     * assert_eq(ptr, table.c_str(id));
+     * assert_eq(0, strcmp("foo", ptr));
+     * ```
+     *
+     * ```should_abort
+     * auto table = SymbolTable();
+     * table.c_str(0);
+     * ```
+     */
+    const char *c_str(Id id) const {
+        assert(id < m_symbols.size());
+        return m_symbols[id].str;
+    }
+
+    /**
+     * Returns the number of bytes interned under the given id.
+     *
+     * ```
+     * auto table = SymbolTable();
+     * assert_eq(3, table.length(table.intern("foo")));
+     * ```
+     */
+    size_t length(Id id) const {
+        assert(id < m_symbols.size());
+        return m_symbols[id].length;
+    }
+
+    /**
+     * Returns a copy of the bytes interned under the given id.
+     *
+     * ```
+     * auto table = SymbolTable();
+     * auto id = table.intern("foo");
+     * assert_str_eq("foo", table.to_string(id));
+     * ```
+     */
+    String to_string(Id id) const {
+        assert(id < m_symbols.size());
+        return String(m_symbols[id].str, m_symbols[id].length);
+    }
+
+    /**
+     * Returns the number of distinct strings in the table.
+     *
+     * ```
+     * auto table = SymbolTable();
+     * assert_eq(0, table.size());
+     * table.intern("foo");
+     * table.intern("foo");
+     * assert_eq(1, table.size());
+     * ```
+     */
+    size_t size() const { return m_symbols.size(); }
+
+    bool is_empty() const { return m_symbols.is_empty(); }
+
+private:
+    struct Key {
+        const char *str;
+        size_t length;
+    };
+
+    static size_t hash_key(Key &key) {
+        size_t hash = 5381;
+        for (size_t i = 0; i < key.length; ++i)
+            hash = ((hash << 5) + hash) + key.str[i];
+        return hash;
+    }
+
+    static bool compare_key(Key &a, Key &b, void *) {
+        return a.length == b.length && memcmp(a.str, b.str, a.length) == 0;
+    }
+
+    const char *store(const char *str, size_t length) {
+        char *dest;
+        if (length > MAX_CHUNKED_LENGTH) {
+            dest = new char[length + 1];
+            m_chunks.push(dest);
+        } else {
+            if (length + 1 > m_chunk_remaining) {
+                m_chunk = new char[CHUNK_SIZE];
+                m_chunk_remaining = CHUNK_SIZE;
+                m_chunks.push(m_chunk);
+            }
+            dest = m_chunk;
+            m_chunk += length + 1;
+            m_chunk_remaining -= length + 1;
+        }
+        if (length > 0)
+            memcpy(dest, str, length);
+        dest[length] = '\0';
+        return dest;
+    }
+
+    Hashmap<Key, Id> m_map;
+    Vector<Key> m_symbols {};
+    Vector<char *> m_chunks {}; // chunks and long strings, freed together
+    char *m_chunk { nullptr };
+    size_t m_chunk_remaining { 0 };
+};
+
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <iostream>
+#include <stddef.h>
 #include <string.h>
 
 #define assert_eq(expected, actual)                                     \
@@ -87,11 +88,11 @@ public:
 
     ~Thing() = default;
 
-    bool operator==(const Thing &other) {
+    bool operator==(const Thing &other) const {
         return m_value == other.m_value;
     }
 
-    bool operator!=(const Thing &other) {
+    bool operator!=(const Thing &other) const {
         return m_value != other.m_value;
     }
 
@@ -105,3 +106,48 @@ inline std::ostream &operator<<(std::ostream &os, const Thing &thing) {
     os << "Thing(" << thing.value() << ")";
     return os;
 }
+
+#if defined(__has_feature)
+#if __has_feature(address_sanitizer) && !defined(__SANITIZE_ADDRESS__)
+#define __SANITIZE_ADDRESS__ 1
+#endif
+#endif
+
+#ifdef __SANITIZE_ADDRESS__
+extern "C" int __sanitizer_install_malloc_and_free_hooks(
+    void (*malloc_hook)(const volatile void *, size_t),
+    void (*free_hook)(const volatile void *));
+
+// Counts heap allocations and frees (malloc, realloc, new, etc.)
+// made after construction. Only available when built with AddressSanitizer,
+// which is how the inline doc tests are compiled.
+class AllocationCounter {
+public:
+    AllocationCounter() {
+        static bool installed = __sanitizer_install_malloc_and_free_hooks(&on_malloc, &on_free);
+        (void)installed;
+        m_allocations_start = total_allocations();
+        m_frees_start = total_frees();
+    }
+
+    size_t allocations() const { return total_allocations() - m_allocations_start; }
+    size_t frees() const { return total_frees() - m_frees_start; }
+
+private:
+    static size_t &total_allocations() {
+        static size_t count = 0;
+        return count;
+    }
+
+    static size_t &total_frees() {
+        static size_t count = 0;
+        return count;
+    }
+
+    static void on_malloc(const volatile void *, size_t) { total_allocations()++; }
+    static void on_free(const volatile void *) { total_frees()++; }
+
+    size_t m_allocations_start { 0 };
+    size_t m_frees_start { 0 };
+};
+#endif
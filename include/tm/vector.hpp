@@ -7,6 +7,9 @@
 #include <string.h>
 #include <type_traits>
 
+#include "tm/simd.hpp"
+#include "tm/span.hpp"
+
 namespace TM {
 
 const int VECTOR_GROW_FACTOR = 2;
@@ -16,17 +19,36 @@ template <typename T>
 class Vector {
 public:
     /**
-     * Constructs an empty vector with the default capacity.
+     * Constructs an empty vector. No memory is allocated until
+     * the first item is added, at which point room for
+     * VECTOR_MIN_CAPACITY items is reserved.
      *
      * ```
      * auto vec = Vector<char> {};
      * assert_eq(0, vec.size());
+     * assert_eq(0, vec.capacity());
+     * vec.push('a');
      * assert_eq(10, vec.capacity());
      * ```
+     *
+     * Empty vectors cost zero heap operations, even when copied or moved.
+     *
+     * ```
+     * auto counter = AllocationCounter();
+     * {
+     *     auto vec1 = Vector<int> {};
+     *     auto vec2 = Vector<Thing> {};
+     *     auto vec3 = Vector<int>(vec1);
+     *     auto vec4 = Vector<Thing>(std::move(vec2));
+     *     vec1 = vec3;
+     *     auto vec5 = vec1.slice(0);
+     *     assert(vec5.is_empty());
+     * }
+     * assert_eq(0, counter.allocations());
+     * assert_eq(0, counter.frees());
+     * ```
      */
-    Vector()
-        : m_capacity { VECTOR_MIN_CAPACITY }
-        , m_data { array_of_size(VECTOR_MIN_CAPACITY) } { }
+    Vector() { }
 
     /**
      * Constructs an empty vector with the given capacity.
@@ -105,6 +127,13 @@ public:
         : m_size { other.m_size }
         , m_capacity { other.m_size }
         , m_data { other.m_data } {
+        if (other.m_inline) {
+            // the other vector's storage lives inside that object, so we cannot take it
+            m_data = array_of_size(other.m_size);
+            move_data(m_data, other.m_data, other.m_size);
+            other.m_size = 0;
+            return;
+        }
         other.m_size = 0;
         other.m_capacity = 0;
         other.m_data = nullptr;
@@ -206,10 +235,19 @@ public:
      * ```
      */
     Vector &operator=(Vector &&other) {
+        if (other.m_inline) {
+            clear();
+            grow_at_least(other.m_size);
+            move_data(m_data, other.m_data, other.m_size);
+            m_size = other.m_size;
+            other.m_size = 0;
+            return *this;
+        }
         delete_memory();
         m_size = other.m_size;
         m_capacity = other.m_capacity;
         m_data = other.m_data;
+        m_inline = false;
         other.m_data = nullptr;
         other.m_size = 0;
         other.m_capacity = 0;
@@ -379,6 +417,8 @@ public:
      * ```
      */
     void concat(const Vector<T> &other) {
+        if (other.m_size == 0)
+            return;
         grow_at_least(m_size + other.size());
         if constexpr (std::is_trivially_copyable<T>::value) {
             memcpy(m_data + m_size, other.m_data, other.m_size * sizeof(T));
@@ -456,6 +496,97 @@ public:
         }
     }
 
+    /**
+     * Appends `count` values copied from the given array,
+     * checking the capacity only once.
+     *
+     * ```
+     * int values[] = { 3, 4, 5 };
+     * auto vec = Vector<int> { 1, 2 };
+     * vec.push_many(values, 3);
+     * assert_eq(5, vec.size());
+     * assert_eq(2, vec[1]);
+     * assert_eq(3, vec[2]);
+     * assert_eq(5, vec[4]);
+     * ```
+     *
+     * This method handles non-trivially-copyable types as well:
+     *
+     * ```
+     * Thing things[] = { Thing(2), Thing(3) };
+     * auto vec = Vector<Thing> { Thing(1) };
+     * vec.push_many(things, 2);
+     * assert_eq(3, vec.size());
+     * assert_eq(Thing(3), vec[2]);
+     * ```
+     *
+     * NOTE: The values must not point into this vector's own storage.
+     */
+    void push_many(const T *values, size_t count) {
+        if (count == 0)
+            return;
+        grow_at_least(m_size + count);
+        if constexpr (std::is_trivially_copyable<T>::value) {
+            memcpy(m_data + m_size, values, count * sizeof(T));
+        } else {
+            for (size_t i = 0; i < count; i++)
+                m_data[m_size + i] = values[i];
+        }
+        m_size += count;
+    }
+
+    /**
+     * Appends every value in the given Span.
+     *
+     * ```
+     * const char list[] = { 'c', 'd', 'e' };
+     * auto vec = Vector<char> { 'a', 'b' };
+     * vec.extend(Span { list, 3 });
+     * assert_eq(5, vec.size());
+     * assert_eq('c', vec[2]);
+     * assert_eq('e', vec[4]);
+     * ```
+     */
+    void extend(Span<T> span) {
+        push_many(span.data(), span.size());
+    }
+
+    /**
+     * Grows the size by `count` and returns a pointer to the first
+     * new slot, so that a bulk producer (e.g. read()) can write
+     * directly into the vector's storage.
+     *
+     * ```
+     * auto vec = Vector<char> { 'a' };
+     * char *slots = vec.append_uninitialized(3);
+     * memcpy(slots, "bcd", 3);
+     * assert_eq(4, vec.size());
+     * assert_eq('b', vec[1]);
+     * assert_eq('d', vec[3]);
+     * ```
+     *
+     * The new slots are not filled with anything. For trivially-copyable
+     * types they hold garbage; other types hold default-constructed
+     * (or previously-popped) objects that should be assigned to.
+     * If fewer slots end up being written, shrink the vector afterward
+     * with set_size().
+     *
+     * ```
+     * auto vec = Vector<int> {};
+     * int *slots = vec.append_uninitialized(100);
+     * slots[0] = 42;
+     * vec.set_size(1);
+     * assert_eq(1, vec.size());
+     * assert_eq(42, vec[0]);
+     * ```
+     */
+    T *append_uninitialized(size_t count) {
+        grow_at_least(m_size + count);
+        T *slots = m_data + m_size;
+        m_size += count;
+        return slots;
+    }
+
     /**
      * Pushes (inserts) a value at the front (index 0).
      *
@@ -622,6 +753,177 @@ public:
         }
     }
 
+    /**
+     * Removes `count` items starting at the given index,
+     * shifting the remaining items over only once.
+     *
+     * ```
+     * auto vec = Vector<char> { 'a', 'b', 'c', 'd', 'e' };
+     * vec.remove_range(1, 3);
+     * assert_eq(2, vec.size());
+     * assert_eq('a', vec[0]);
+     * assert_eq('e', vec[1]);
+     * ```
+     *
+     * This method aborts if the range extends past the end.
+     *
+     * ```should_abort
+     * auto vec = Vector<char> { 'a', 'b', 'c' };
+     * vec.remove_range(2, 2);
+     * ```
+     *
+     * This method handles non-trivially-copyable types as well:
+     *
+     * ```
+     * auto vec = Vector<Thing> { Thing(1), Thing(2), Thing(3), Thing(4) };
+     * vec.remove_range(0, 2);
+     * assert_eq(2, vec.size());
+     * assert_eq(Thing(3), vec[0]);
+     * assert_eq(Thing(4), vec[1]);
+     * ```
+     */
+    void remove_range(size_t start, size_t count) {
+        assert(start <= m_size && count <= m_size - start);
+        if (count == 0)
+            return;
+
+        const size_t tail = m_size - start - count;
+        if constexpr (std::is_trivially_copyable<T>::value) {
+            memmove(m_data + start, m_data + start + count, tail * sizeof(T));
+        } else {
+            for (size_t i = 0; i < tail; ++i)
+                m_data[start + i] = std::move(m_data[start + count + i]);
+        }
+        m_size -= count;
+    }
+
+    /**
+     * Removes the item at the given index by moving the last
+     * item into its place. This is O(1), but does not preserve
+     * the order of the remaining items.
+     *
+     * ```
+     * auto vec = Vector<char> { 'a', 'b', 'c', 'd' };
+     * vec.swap_remove(1);
+     * assert_eq(3, vec.size());
+     * assert_eq('a', vec[0]);
+     * assert_eq('d', vec[1]);
+     * assert_eq('c', vec[2]);
+     * vec.swap_remove(2);
+     * assert_eq(2, vec.size());
+     * assert_eq('d', vec[1]);
+     * ```
+     *
+     * This method aborts if the index is past the end.
+     *
+     * ```should_abort
+     * auto vec = Vector<char> { 'a' };
+     * vec.swap_remove(1);
+     * ```
+     */
+    void swap_remove(size_t index) {
+        assert(index < m_size);
+        --m_size;
+        if (index != m_size)
+            m_data[index] = std::move(m_data[m_size]);
+    }
+
+    /**
+     * Removes every item for which the given lambda or callable
+     * returns true, compacting the vector in a single pass.
+     * The order of the remaining items is preserved.
+     * Returns the number of items removed.
+     *
+     * ```
+     * auto vec = Vector<int> { 1, 2, 3, 4, 5, 6, 7 };
+     * auto removed = vec.remove_if([](int i) { return i % 2 == 0; });
+     * assert_eq(3, removed);
+     * assert_eq(4, vec.size());
+     * assert_eq(1, vec[0]);
+     * assert_eq(3, vec[1]);
+     * assert_eq(5, vec[2]);
+     * assert_eq(7, vec[3]);
+     * ```
+     *
+     * This method handles non-trivially-copyable types as well:
+     *
+     * ```
+     * auto vec = Vector<Thing> { Thing(1), Thing(2), Thing(3), Thing(4) };
+     * vec.remove_if([](Thing &t) { return t.value() < 3; });
+     * assert_eq(2, vec.size());
+     * assert_eq(Thing(3), vec[0]);
+     * assert_eq(Thing(4), vec[1]);
+     * ```
+     *
+     * The callable is called exactly once for each item.
+     *
+     * ```
+     * auto vec = Vector<int> { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+     * auto calls = Vector<int> {};
+     * vec.remove_if([&calls](int i) { calls.push(i); return i % 3 == 0; });
+     * assert_eq(9, calls.size());
+     * for (size_t i = 0; i < calls.size(); i++)
+     *     assert_eq((int)i + 1, calls[i]);
+     * assert_eq(6, vec.size());
+     *
+     * auto things = Vector<Thing> { Thing(1), Thing(2), Thing(3) };
+     * size_t count = 0;
+     * things.remove_if([&count](Thing &t) { count++; return t.value() == 2; });
+     * assert_eq(3, count);
+     * ```
+     */
+    template <typename F>
+    size_t remove_if(F predicate) {
+        size_t write = 0;
+        size_t read = 0;
+        while (read < m_size) {
+            if (predicate(m_data[read])) {
+                ++read;
+                continue;
+            }
+            if constexpr (std::is_trivially_copyable<T>::value) {
+                // move the whole run of kept items at once
+                size_t run_end = read + 1;
+                while (run_end < m_size && !predicate(m_data[run_end]))
+                    ++run_end;
+                if (write != read)
+                    memmove(m_data + write, m_data + read, (run_end - read) * sizeof(T));
+                write += run_end - read;
+                // the item that ended the run matched, so skip it
+                // rather than calling the predicate on it again
+                read = run_end + 1;
+            } else {
+                if (write != read)
+                    m_data[write] = std::move(m_data[read]);
+                ++write;
+                ++read;
+            }
+        }
+        const size_t removed = m_size - write;
+        m_size = write;
+        return removed;
+    }
+
+    /**
+     * Keeps only the items for which the given lambda or callable
+     * returns true, compacting the vector in a single pass.
+     * This is the opposite of remove_if().
+     * Returns the number of items removed.
+     *
+     * ```
+     * auto vec = Vector<char> { 'a', 'B', 'c', 'D' };
+     * auto removed = vec.retain([](char c) { return c >= 'a'; });
+     * assert_eq(2, removed);
+     * assert_eq(2, vec.size());
+     * assert_eq('a', vec[0]);
+     * assert_eq('c', vec[1]);
+     * ```
+     */
+    template <typename F>
+    size_t retain(F predicate) {
+        return remove_if([&predicate](T &item) { return !predicate(item); });
+    }
+
     /**
      * Returns true if the vector has no items.
      *
@@ -667,6 +969,113 @@ public:
     T *data() { return m_data; }
     const T *data() const { return m_data; }
 
+    /**
+     * Returns the index of the first item equal to the given value,
+     * or -1 if it is not found.
+     *
+     * ```
+     * auto vec = Vector<uint32_t> { 10, 20, 30, 20 };
+     * assert_eq(1, vec.find(20));
+     * assert_eq(-1, vec.find(40));
+     * ```
+     *
+     * Vectors of integral, pointer and floating-point types are searched
+     * with SIMD instructions when the CPU supports them (see SIMD).
+     * Other types are compared one at a time with ==.
+     *
+     * ```
+     * auto vec = Vector<Thing> { Thing(1), Thing(2) };
+     * assert_eq(1, vec.find(Thing(2)));
+     * assert_eq(-1, vec.find(Thing(3)));
+     * ```
+     */
+    ssize_t find(const T &value) const {
+        return SIMD::find<T>(m_data, m_size, value);
+    }
+
+    /**
+     * Returns true if the vector has an item equal to the given value.
+     *
+     * ```
+     * auto thing = Thing(1);
+     * auto vec = Vector<void *> { &thing, nullptr };
+     * assert(vec.contains(&thing));
+     * assert(vec.contains(nullptr));
+     * assert_not(vec.contains(&vec));
+     * ```
+     */
+    bool contains(const T &value) const {
+        return find(value) != -1;
+    }
+
+    /**
+     * Returns the number of items equal to the given value.
+     *
+     * ```
+     * auto vec = Vector<char> { 'a', 'b', 'a', 'c', 'a' };
+     * assert_eq(3, vec.count('a'));
+     * assert_eq(0, vec.count('z'));
+     * ```
+     */
+    size_t count(const T &value) const {
+        return SIMD::count<T>(m_data, m_size, value);
+    }
+
+    /**
+     * Returns the index of the first item *not* equal to the
+     * given value, or -1 if every item is equal to it.
+     *
+     * ```
+     * auto vec = Vector<int> { 0, 0, 0, 5, 0 };
+     * assert_eq(3, vec.index_of_first_not(0));
+     * assert_eq(0, vec.index_of_first_not(5));
+     *
+     * auto zeros = Vector<int>(10, 0);
+     * assert_eq(-1, zeros.index_of_first_not(0));
+     * ```
+     */
+    ssize_t index_of_first_not(const T &value) const {
+        return SIMD::index_of_first_not<T>(m_data, m_size, value);
+    }
+
+    /**
+     * Returns the smallest item, compared with <.
+     *
+     * ```
+     * auto vec = Vector<int> { 3, -1, 4, 1, -5, 9 };
+     * assert_eq(-5, vec.min());
+     * ```
+     *
+     * If the vector is empty, then this method aborts.
+     *
+     * ```should_abort
+     * auto vec = Vector<int> {};
+     * vec.min();
+     * ```
+     */
+    T min() const {
+        return SIMD::min<T>(m_data, m_size);
+    }
+
+    /**
+     * Returns the largest item, compared with <.
+     *
+     * ```
+     * auto vec = Vector<double> { 3.5, -1, 4.25, 1 };
+     * assert_eq(4.25, vec.max());
+     * ```
+     *
+     * If the vector is empty, then this method aborts.
+     *
+     * ```should_abort
+     * auto vec = Vector<int> {};
+     * vec.max();
+     * ```
+     */
+    T max() const {
+        return SIMD::max<T>(m_data, m_size);
+    }
+
     /**
      * Fill the given range with a filler value.
      *
@@ -753,6 +1162,25 @@ public:
         grow_at_least(new_size);
     }
 
+    /**
+     * Makes room for at least `capacity` items without
+     * changing the size. Unlike set_capacity(), this does not
+     * round up to the next growth step, so reserving the exact
+     * number of items a bulk producer will write wastes no memory.
+     *
+     * ```
+     * auto vec = Vector<int> { 1, 2, 3 };
+     * vec.reserve(25);
+     * assert_eq(25, vec.capacity());
+     * assert_eq(3, vec.size());
+     * vec.reserve(5); // never shrinks
+     * assert_eq(25, vec.capacity());
+     * ```
+     */
+    void reserve(size_t capacity) {
+        grow(capacity);
+    }
+
     class iterator {
     public:
         iterator(const Vector<T> *vector, size_t index)
@@ -838,7 +1266,16 @@ protected:
         , m_capacity(capacity)
         , m_data(data) { }
 
+    // Used by SmallVector to point at storage embedded in the object itself.
+    // That storage is never freed, and is abandoned once the vector outgrows it.
+    Vector(T *inline_data, size_t inline_capacity)
+        : m_capacity(inline_capacity)
+        , m_data(inline_data)
+        , m_inline(true) { }
+
     static T *array_of_size(size_t size) {
+        if (size == 0)
+            return nullptr;
         if constexpr (std::is_trivially_copyable<T>::value)
             return reinterpret_cast<T *>(malloc(size * sizeof(T)));
         else
@@ -848,7 +1285,12 @@ protected:
     void grow(size_t capacity) {
         if (m_capacity >= capacity)
             return;
-        if constexpr (std::is_trivially_copyable<T>::value) {
+        if (m_inline) {
+            auto inline_data = m_data;
+            m_data = array_of_size(capacity);
+            move_data(m_data, inline_data, m_size);
+            m_inline = false;
+        } else if constexpr (std::is_trivially_copyable<T>::value) {
             m_data = static_cast<T *>(realloc(m_data, capacity * sizeof(T)));
         } else {
             auto old_data = m_data;
@@ -864,7 +1306,9 @@ protected:
         if (m_capacity >= min_capacity) {
             return;
         }
-        if (m_capacity > 0 && min_capacity <= m_capacity * VECTOR_GROW_FACTOR) {
+        if (m_capacity == 0) {
+            grow(std::max<size_t>(min_capacity, VECTOR_MIN_CAPACITY));
+        } else if (min_capacity <= m_capacity * VECTOR_GROW_FACTOR) {
             grow(m_capacity * VECTOR_GROW_FACTOR);
         } else {
             grow(min_capacity);
@@ -900,6 +1344,8 @@ protected:
     }
 
     void copy_data(T *dest, T *src, size_t size) {
+        if (size == 0)
+            return;
         if constexpr (std::is_trivially_copyable<T>::value) {
             memcpy(dest, src, sizeof(T) * size);
         } else {
@@ -908,7 +1354,20 @@ protected:
         }
     }
 
+    void move_data(T *dest, T *src, size_t size) {
+        if (size == 0)
+            return;
+        if constexpr (std::is_trivially_copyable<T>::value) {
+            memcpy(dest, src, sizeof(T) * size);
+        } else {
+            for (size_t i = 0; i < size; ++i)
+                dest[i] = std::move(src[i]);
+        }
+    }
+
     void delete_memory() {
+        if (m_inline)
+            return;
         if constexpr (std::is_trivially_copyable<T>::value)
             free(m_data);
         else
@@ -938,6 +1397,7 @@ protected:
     size_t m_size { 0 };
     size_t m_capacity { 0 };
     T *m_data { nullptr };
+    bool m_inline { false };
 };
 
 template <typename T>
@@ -988,4 +1448,186 @@ private:
     bool m_released { false };
 };
 
+template <typename T, size_t N>
+class SmallVector : public Vector<T> {
+public:
+    /**
+     * Constructs an empty SmallVector. Up to N items are stored
+     * inside the object itself, so no memory is allocated until
+     * the vector grows past that.
+     *
+     * ```
+     * auto vec = SmallVector<int, 4> {};
+     * assert_eq(0, vec.size());
+     * assert_eq(4, vec.capacity());
+     * assert(vec.is_inline());
+     * ```
+     *
+     * A SmallVector can be passed anywhere a Vector reference is expected.
+     *
+     * ```
+     * // top-level ----
+     * size_t small_vector_sum(const Vector<int> &vec) {
+     *     size_t sum = 0;
+     *     for (auto i : vec)
+     *         sum += i;
+     *     return sum;
+     * }
+     * // end-top-level ----
+     *
+     * auto vec = SmallVector<int, 3> { 1, 2, 3 };
+     * assert_eq(6, small_vector_sum(vec));
+     * ```
+     */
+    SmallVector()
+        : Vector<T>(m_inline_data, N) { }
+
+    /**
+     * Constructs a SmallVector with the given list of items.
+     *
+     * ```
+     * auto vec = SmallVector<char, 4> { 'a', 'b', 'c' };
+     * assert_eq(3, vec.size());
+     * assert_eq('c', vec[2]);
+     * assert(vec.is_inline());
+     * ```
+     *
+     * If the list does not fit, the items are moved to the heap.
+     *
+     * ```
+     * auto vec = SmallVector<Thing, 2> { Thing(1), Thing(2), Thing(3) };
+     * assert_eq(3, vec.size());
+     * assert_eq(Thing(1), vec[0]);
+     * assert_eq(Thing(3), vec[2]);
+     * assert_not(vec.is_inline());
+     * ```
+     */
+    SmallVector(std::initializer_list<T> list)
+        : SmallVector() {
+        this->grow_at_least(list.size());
+        for (const auto &v : list) {
+            this->push(v);
+        }
+    }
+
+    /**
+     * Constructs a SmallVector by copying data from another vector.
+     *
+     * ```
+     * auto vec1 = SmallVector<Thing, 2> { Thing(1), Thing(2) };
+     * auto vec2 = SmallVector<Thing, 2>(vec1);
+     * assert_eq(2, vec2.size());
+     * assert_eq(Thing(2), vec2[1]);
+     * assert(vec2.is_inline());
+     * ```
+     */
+    SmallVector(const SmallVector &other)
+        : SmallVector() {
+        this->concat(other);
+    }
+
+    /**
+     * Constructs a SmallVector by moving from another one.
+     * Inline items are moved one by one, while heap storage
+     * is taken over without copying.
+     *
+     * ```
+     * auto vec1 = SmallVector<Thing, 2> { Thing(1) };
+     * auto vec2 = SmallVector<Thing, 2>(std::move(vec1));
+     * assert_eq(1, vec2.size());
+     * assert_eq(Thing(1), vec2[0]);
+     * assert_eq(0, vec1.size());
+     *
+     * auto vec3 = SmallVector<int, 2> { 1, 2, 3 };
+     * auto data = vec3.data();
+     * auto vec4 = SmallVector<int, 2>(std::move(vec3));
+     * assert_eq(data, vec4.data());
+     * assert_eq(3, vec4[2]);
+     * assert(vec3.is_inline());
+     * vec3.push(4);
+     * assert_eq(4, vec3[0]);
+     * ```
+     */
+    SmallVector(SmallVector &&other)
+        : SmallVector() {
+        *this = std::move(other);
+    }
+
+    /**
+     * Overwrites the SmallVector data with that of another one.
+     *
+     * ```
+     * auto vec1 = SmallVector<char, 4> { 'a', 'b', 'c' };
+     * auto vec2 = SmallVector<char, 4> { 'x', 'y' };
+     * vec1 = vec2;
+     * assert_eq(2, vec1.size());
+     * assert_eq('y', vec1[1]);
+     * ```
+     */
+    SmallVector &operator=(const SmallVector &other) {
+        this->clear();
+        this->concat(other);
+        return *this;
+    }
+
+    /**
+     * Moves another SmallVector's data into this one.
+     * The other vector is left empty, with its inline storage ready for reuse.
+     *
+     * ```
+     * auto vec1 = SmallVector<char, 2> { 'a' };
+     * auto vec2 = SmallVector<char, 2> { 'x', 'y', 'z' };
+     * vec1 = std::move(vec2);
+     * assert_eq(3, vec1.size());
+     * assert_eq('z', vec1[2]);
+     * assert_eq(0, vec2.size());
+     * assert(vec2.is_inline());
+     * ```
+     */
+    SmallVector &operator=(SmallVector &&other) {
+        Vector<T>::operator=(std::move(other));
+        if (!other.m_data)
+            other.reset_to_inline_storage();
+        return *this;
+    }
+
+    /**
+     * Returns true if the items are still stored inside this object,
+     * i.e. the vector has not grown past N items.
+     *
+     * ```
+     * auto vec = SmallVector<int, 2> {};
+     * vec.push(1);
+     * vec.push(2);
+     * assert(vec.is_inline());
+     * vec.push(3);
+     * assert_not(vec.is_inline());
+     * assert_eq(3, vec.size());
+     * assert_eq(1, vec[0]);
+     * assert_eq(3, vec[2]);
+     * ```
+     */
+    bool is_inline() const { return this->m_inline; }
+
+    /**
+     * Returns the number of items that fit in the inline storage.
+     *
+     * ```
+     * auto vec = SmallVector<int, 3> { 1, 2, 3, 4 };
+     * assert_eq(3, vec.inline_capacity());
+     * ```
+     */
+    static constexpr size_t inline_capacity() { return N; }
+
+private:
+    void reset_to_inline_storage() {
+        this->m_data = m_inline_data;
+        this->m_capacity = N;
+        this->m_size = 0;
+        this->m_inline = true;
+    }
+
+    T m_inline_data[N];
+};
+
 }